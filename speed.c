@@ -558,6 +558,69 @@ exec_test()
     return ret;
 }
 
+/*
+    memory taken by nodes and attribs of parsed documents, it depends on
+    RELIQ_HTML_SIZE and RELIQ_HTML_HUGE
+*/
+void
+layout_report()
+{
+    const size_t testsl = LENGTH(tests);
+    size_t nodesl = 0, attribsl = 0;
+    for (size_t i = 0; i < testsl; i++) {
+        for (size_t j = 0; tests[i].files[j]; j++) {
+            nodesl += tests[i].rqs[j].nodesl;
+            attribsl += tests[i].rqs[j].attribsl;
+        }
+    }
+
+    const size_t memory = nodesl*sizeof(reliq_chnode)+attribsl*sizeof(reliq_cattrib);
+    fprintf(stderr,"layout chnode(%lu) cattrib(%lu) nodes(%lu) attribs(%lu) memory(%lu)\n",
+        sizeof(reliq_chnode),sizeof(reliq_cattrib),nodesl,attribsl,memory);
+}
+
+/*
+    document with a lot of stray end tags, each of them has to be resolved
+    against open elements, e.g. <div><b>x</i></b><b>x</i></b>...</div>
+*/
+#define MISNESTED_REPEAT 20000
+
+char *misnested;
+size_t misnestedl;
+reliq misnested_rq;
+
+void
+misnested_create()
+{
+    const char start[] = "<div>",
+        middle[] = "<b>x</i></b>",
+        end[] = "</div>";
+    const size_t middlel = sizeof(middle)-1;
+
+    misnestedl = sizeof(start)-1+middlel*MISNESTED_REPEAT+sizeof(end)-1;
+    misnested = malloc(misnestedl);
+
+    char *p = misnested;
+    memcpy(p,start,sizeof(start)-1);
+    p += sizeof(start)-1;
+    for (size_t i = 0; i < MISNESTED_REPEAT; i++, p += middlel)
+        memcpy(p,middle,middlel);
+    memcpy(p,end,sizeof(end)-1);
+}
+
+size_t
+misnested_parse_test()
+{
+    assert(reliq_init(misnested,misnestedl,&misnested_rq) == NULL);
+    return 1;
+}
+
+void
+free_misnested_rq()
+{
+    assert(reliq_free(&misnested_rq) == 0);
+}
+
 double
 timediff(struct timespec *t1, struct timespec *t2)
 {
@@ -619,8 +682,14 @@ main(int argc, char *argv[])
 
     measuretest("exprs",500*12,expr_comp_test,free_exprs);
     measuretest("html",18*12,html_parse_test,free_rqs);
+    layout_report();
     measuretest("exec",1*12,exec_test,NULL);
 
+    misnested_create();
+    measuretest("html misnested",10,misnested_parse_test,free_misnested_rq);
+    free_misnested_rq();
+    free(misnested);
+
     free_exprs();
     free_rqs();
 
@@ -40,7 +40,7 @@
 
 #define F_RECURSIVE 0x1
 
-#define BUFF_INC_VALUE (1<<23)
+#define READ_SIZE (1<<16)
 
 char *argv0;
 reliq_expr *expr = NULL;
@@ -58,6 +58,14 @@ void usage(const char *argv0, FILE *o);
 char *url_ref = NULL;
 size_t url_refl = 0;
 
+char *records_name = NULL;
+size_t records_namel = 0;
+
+char *save_path = NULL;
+bool load_saved = false;
+
+uint8_t skip = 0; //RELIQ_SKIP_
+
 struct pretty_settings psettings = {0};
 
 enum {
@@ -239,7 +247,44 @@ expr_exec(char *f, size_t s, int (*freedata)(void*,size_t))
   reliq_error *err;
 
   reliq rq;
-  if ((err = reliq_init(f,s,&rq)))
+  if ((err = reliq_init_skip(f,s,skip,&rq)))
+    goto ERR;
+
+  if (save_path) {
+    err = reliq_save(&rq,save_path);
+  } else {
+    if (url_ref)
+      reliq_set_url(&rq,url_ref,url_refl);
+    err = reliq_exec_file(&rq,NULL,0,expr,outfile);
+  }
+
+  reliq_free(&rq);
+  freedata(f,s);
+
+  ERR: ;
+  if (err) {
+    reliq_efree(expr);
+    handle_reliq_error(err);
+  }
+}
+
+static void
+records_exec(FILE *f)
+{
+  reliq_error *err = reliq_exec_records(f,records_name,records_namel,expr,url_ref,url_refl,outfile);
+  if (err) {
+    reliq_efree(expr);
+    handle_reliq_error(err);
+  }
+}
+
+static void
+saved_exec(const char *f)
+{
+  reliq_error *err;
+
+  reliq rq;
+  if ((err = reliq_load_mmap(f,&rq)))
     goto ERR;
 
   if (url_ref)
@@ -248,7 +293,6 @@ expr_exec(char *f, size_t s, int (*freedata)(void*,size_t))
   err = reliq_exec_file(&rq,NULL,0,expr,outfile);
 
   reliq_free(&rq);
-  freedata(f,s);
 
   ERR: ;
   if (err) {
@@ -260,15 +304,21 @@ expr_exec(char *f, size_t s, int (*freedata)(void*,size_t))
 static void
 pipe_to_str(int fd, char **file, size_t *size)
 {
-  *file = NULL;
-  register size_t readbytes = 0;
+  //buffer is doubled so that reading big input doesn't reallocate on every read()
+  size_t allocated = READ_SIZE;
+  *file = malloc(allocated);
   *size = 0;
 
-  do {
+  while (1) {
+    if (allocated-*size < READ_SIZE) {
+      allocated <<= 1;
+      *file = realloc(*file,allocated);
+    }
+    const ssize_t readbytes = read(fd,*file+*size,READ_SIZE);
+    if (readbytes <= 0)
+      break;
     *size += readbytes;
-    *file = realloc(*file,*size+BUFF_INC_VALUE);
-    readbytes = read(fd,*file+*size,BUFF_INC_VALUE);
-  } while (readbytes > 0);
+  }
   *file = realloc(*file,*size);
 }
 
@@ -279,7 +329,20 @@ file_handle(const char *f)
   struct stat st;
   char *file;
 
+  const bool records = (records_name && run_mode == htmlProcess);
+
+  if (load_saved && run_mode == htmlProcess) {
+    if (f == NULL)
+      die("%s: --load requires FILE",argv0);
+    saved_exec(f);
+    return;
+  }
+
   if (f == NULL) {
+    if (records) {
+      records_exec(stdin);
+      return;
+    }
     size_t size;
     pipe_to_str(0,&file,&size);
     file_exec(file,size,reliq_std_free);
@@ -313,6 +376,13 @@ file_handle(const char *f)
     return;
   }
 
+  if (records) {
+    FILE *input = fdopen(fd,"rb");
+    records_exec(input);
+    fclose(input);
+    return;
+  }
+
   #if defined(__MINGW32__) || defined(__MINGW64__)
   file = malloc(st.st_size);
   if (read(fd,file,st.st_size) == -1) {
@@ -378,11 +448,17 @@ static void
 file_exec_set(int argc, const char **argv)
 {
   if (run_mode == htmlProcess) {
-    if (!expr && optind < argc) {
+    if (save_path && (load_saved || records_name))
+      die("%s: --save cannot be used with --load or --records",argv0);
+    //document is saved without running any expression so all arguments are FILEs
+    if (!expr && !save_path && optind < argc) {
       handle_reliq_error(reliq_ecomp(argv[optind],strlen(argv[optind]),&expr));
       optind++;
       assert(expr);
     }
+    //saved document can be loaded later for other expressions
+    if (expr && !save_path)
+      skip |= reliq_expr_skip(expr);
     file_exec = expr_exec;
   } else if (run_mode == htmlPrettify) {
     file_exec = html_prettify;
@@ -472,6 +548,33 @@ longopts_handle(const char *name)
   if (longopts_handle_mode(name))
     return;
 
+  if (strcmp(name,"records") == 0) {
+    run_mode = htmlProcess;
+    records_name = optarg;
+    records_namel = strlen(optarg);
+    return;
+  }
+  if (strcmp(name,"save") == 0) {
+    run_mode = htmlProcess;
+    save_path = optarg;
+    return;
+  }
+  if (strcmp(name,"load") == 0) {
+    run_mode = htmlProcess;
+    load_saved = true;
+    return;
+  }
+  if (strcmp(name,"skip-empty") == 0) {
+    run_mode = htmlProcess;
+    skip |= RELIQ_SKIP_TEXT_EMPTY;
+    return;
+  }
+  if (strcmp(name,"skip-comments") == 0) {
+    run_mode = htmlProcess;
+    skip |= RELIQ_SKIP_COMMENTS;
+    return;
+  }
+
   if (longopts_handle_html_prettify(name))
     return;
 }
@@ -506,6 +609,11 @@ main(int argc, char **argv)
     {"expression",required_argument,NULL,'e'},
     {"file",required_argument,NULL,'f'},
     {"url",required_argument,NULL,'u'},
+    {"records",required_argument,NULL,0},
+    {"save",required_argument,NULL,0},
+    {"load",no_argument,NULL,0},
+    {"skip-empty",no_argument,NULL,0},
+    {"skip-comments",no_argument,NULL,0},
 
     {"html",no_argument,NULL,0},
     {"pretty",no_argument,NULL,'p'},
@@ -395,7 +395,7 @@ print_pretty_comment(const reliq_hnode *node, const struct pretty_state *st, siz
 static const reliq_cattrib *
 order_cattribs_find(const reliq_cattrib *attribs, const size_t attribsl, const reliq_cattrib *attr)
 {
-  const uint32_t key = attr->key;
+  const reliq_off key = attr->key;
   for (size_t i = 0 ; i < attribsl; i++)
     if (attribs[i].key == key)
       return attribs+i;
@@ -184,8 +184,10 @@ usage(const char *argv0, FILE *o)
   color(COLOR_SCRIPT,"PATTERNS");
   fputs(" unless -",o);
   color(COLOR_OPTION,"f");
-  fputs(" or -",o);
+  fputs(", -",o);
   color(COLOR_OPTION,"e");
+  fputs(" or --",o);
+  color(COLOR_OPTION,"save");
   fputs(" options are set",o);
   end_default(NULL);
 
@@ -210,6 +212,37 @@ usage(const char *argv0, FILE *o)
   fputs("\t\t\tset url reference for joining",o);
   fputc('\n',o);
 
+  color_option(NULL,"records","NAME");
+  fputs("\t\trun ",o);
+  color(COLOR_SCRIPT,"PATTERNS");
+  fputs(" on each element named ",o);
+  color(COLOR_ARG,"NAME");
+  fputs(" separately, without loading whole ",o);
+  color(COLOR_INPUT,"FILE");
+  fputc('\n',o);
+
+  color_option(NULL,"save","FILE");
+  fputs("\t\tsave parsed ",o);
+  color(COLOR_INPUT,"FILE");
+  fputs(" to ",o);
+  color(COLOR_ARG,"FILE");
+  fputs(" instead of processing it, without taking ",o);
+  color(COLOR_SCRIPT,"PATTERNS");
+  fputc('\n',o);
+
+  color_option(NULL,"load",NULL);
+  fputs("\t\t\ttreat ",o);
+  color(COLOR_INPUT,"FILE");
+  fputs(" as made by --",o);
+  color(COLOR_OPTION,"save");
+  fputs(" and load it without parsing\n",o);
+
+  color_option(NULL,"skip-empty",NULL);
+  fputs("\t\tleave out text nodes that have only whitespace\n",o);
+
+  color_option(NULL,"skip-comments",NULL);
+  fputs("\tleave out comments\n",o);
+
   fputs("\n--",o);
   color(COLOR_SECTION,"urljoin");
   fputs(": join urls passed as arguments with first url passed\n",o);
@@ -21,16 +21,17 @@
 
 #include "builtin.h"
 #include "flexarr.h"
+#include "lib/alloc.h"
 
 static inline void * ATTR_MALLOC
 flexarr_realloc(void *ptr, size_t size)
 {
   if (unlikely(!size)) {
     if (ptr)
-      free(ptr);
+      mem_free(ptr);
     return NULL;
   }
-  return realloc(ptr,size);
+  return mem_realloc(ptr,size);
 }
 
 static inline size_t
@@ -152,7 +153,7 @@ void
 flexarr_free(flexarr *f)
 {
   if (likely(f->asize))
-    free(f->v);
+    mem_free(f->v);
   f->v = NULL;
   f->size = 0;
   f->asize = 0;
@@ -0,0 +1,223 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "../ext.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+#define ARENA_BLOCK_SIZE (1<<20)
+#define ARENA_ALIGN 16
+#define ARENA_HEADER ARENA_ALIGN //size of allocation is kept before it
+#define ARENA_ALIGNED(x) (((x)+ARENA_ALIGN-1)&~(size_t)(ARENA_ALIGN-1))
+
+static _Thread_local const reliq_allocator *allocator_current = NULL;
+
+void
+reliq_set_allocator(const reliq_allocator *allocator)
+{
+  allocator_current = allocator;
+}
+
+const reliq_allocator *
+reliq_get_allocator(void)
+{
+  return allocator_current;
+}
+
+void *
+mem_alloc(const size_t size)
+{
+  const reliq_allocator *a = allocator_current;
+  if (!a)
+    return malloc(size);
+  return a->alloc(a->user,size);
+}
+
+void *
+mem_calloc(const size_t count, const size_t size)
+{
+  const reliq_allocator *a = allocator_current;
+  if (!a)
+    return calloc(count,size);
+
+  const size_t total = count*size;
+  if (size && total/size != count)
+    return NULL;
+  void *ret = a->alloc(a->user,total);
+  if (ret)
+    memset(ret,0,total);
+  return ret;
+}
+
+void *
+mem_realloc(void *ptr, const size_t size)
+{
+  const reliq_allocator *a = allocator_current;
+  if (!a)
+    return realloc(ptr,size);
+  return a->realloc(a->user,ptr,size);
+}
+
+void
+mem_free(void *ptr)
+{
+  const reliq_allocator *a = allocator_current;
+  if (!a) {
+    free(ptr);
+    return;
+  }
+  if (ptr)
+    a->free(a->user,ptr);
+}
+
+struct arena_block {
+  struct arena_block *prev;
+  size_t size; //size of .data
+  size_t used;
+  _Alignas(ARENA_ALIGN) unsigned char data[];
+};
+
+struct reliq_arena {
+  struct arena_block *block; //the newest block
+  unsigned char *last; //the latest allocation, its space can be given back
+  size_t blocksize;
+};
+
+reliq_arena *
+reliq_arena_new(const size_t blocksize)
+{
+  reliq_arena *arena = calloc(1,sizeof(reliq_arena));
+  arena->blocksize = blocksize ? blocksize : ARENA_BLOCK_SIZE;
+  return arena;
+}
+
+static struct arena_block *
+arena_block_add(reliq_arena *arena, const size_t needed)
+{
+  const size_t size = (needed > arena->blocksize) ? needed : arena->blocksize;
+  struct arena_block *block = malloc(sizeof(struct arena_block)+size);
+  if (!block)
+    return NULL;
+  block->prev = arena->block;
+  block->size = size;
+  block->used = 0;
+  arena->block = block;
+  return block;
+}
+
+static void *
+arena_alloc(void *user, size_t size)
+{
+  reliq_arena *arena = user;
+  const size_t needed = ARENA_HEADER+ARENA_ALIGNED(size);
+  struct arena_block *block = arena->block;
+  if (!block || block->size-block->used < needed) {
+    if (!(block = arena_block_add(arena,needed)))
+      return NULL;
+  }
+
+  unsigned char *ret = block->data+block->used+ARENA_HEADER;
+  *(size_t*)(ret-ARENA_HEADER) = size;
+  block->used += needed;
+  arena->last = ret;
+  return ret;
+}
+
+static void *
+arena_realloc(void *user, void *ptr, size_t size)
+{
+  reliq_arena *arena = user;
+  if (!ptr)
+    return arena_alloc(user,size);
+
+  unsigned char *p = ptr;
+  const size_t oldsize = *(size_t*)(p-ARENA_HEADER);
+  struct arena_block *block = arena->block;
+
+  //the latest allocation can grow or shrink in place
+  if (p == arena->last) {
+    const size_t start = p-block->data;
+    const size_t end = start+ARENA_ALIGNED(size);
+    if (end <= block->size) {
+      block->used = end;
+      *(size_t*)(p-ARENA_HEADER) = size;
+      return p;
+    }
+  }
+
+  unsigned char *ret = arena_alloc(user,size);
+  if (ret)
+    memcpy(ret,p,(oldsize < size) ? oldsize : size);
+  return ret;
+}
+
+static void
+arena_free(void *user, void *ptr)
+{
+  reliq_arena *arena = user;
+  if (ptr != arena->last)
+    return;
+  arena->block->used = arena->last-ARENA_HEADER-arena->block->data;
+  arena->last = NULL;
+}
+
+reliq_allocator
+reliq_arena_allocator(reliq_arena *arena)
+{
+  return (reliq_allocator){
+    .alloc = arena_alloc,
+    .realloc = arena_realloc,
+    .free = arena_free,
+    .user = arena
+  };
+}
+
+void
+reliq_arena_reset(reliq_arena *arena)
+{
+  struct arena_block *block = arena->block;
+  if (!block)
+    return;
+
+  //the oldest block is kept
+  while (block->prev) {
+    struct arena_block *prev = block->prev;
+    free(block);
+    block = prev;
+  }
+  block->used = 0;
+  arena->block = block;
+  arena->last = NULL;
+}
+
+void
+reliq_arena_free(reliq_arena *arena)
+{
+  if (!arena)
+    return;
+  struct arena_block *block = arena->block;
+  while (block) {
+    struct arena_block *prev = block->prev;
+    free(block);
+    block = prev;
+  }
+  free(arena);
+}
@@ -0,0 +1,37 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef RELIQ_ALLOC_H
+#define RELIQ_ALLOC_H
+
+#include <stddef.h>
+
+#include "reliq.h"
+
+/*
+    All memory of the library is allocated through these, they use
+    allocator set by reliq_set_allocator() in the calling thread or
+    functions from stdlib.h if it's not set.
+*/
+
+void *mem_alloc(const size_t size);
+void *mem_calloc(const size_t count, const size_t size);
+void *mem_realloc(void *ptr, const size_t size);
+void mem_free(void *ptr);
+
+#endif
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <regex.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "types.h"
 #include "utils.h"
@@ -303,12 +304,12 @@ sed_expression_free(struct sed_expression *e)
   sed_address_free(&e->address);
   if (e->name == 'y') {
     if (e->arg1)
-      free(e->arg1);
+      mem_free(e->arg1);
     if (e->arg2)
-      free(e->arg2);
+      mem_free(e->arg2);
   } else if (e->name == 's' && e->arg1) {
     regfree(e->arg1);
-    free(e->arg1);
+    mem_free(e->arg1);
   }
 }
 
@@ -433,8 +434,8 @@ sed_comp_y(const size_t pos, const char name, struct sed_expression *sedexpr, re
   if (third->s)
     return sed_EXTRACHARS(pos);
 
-  sedexpr->arg1 = calloc(256,sizeof(char));
-  sedexpr->arg2 = calloc(256,sizeof(uint8_t));
+  sedexpr->arg1 = mem_calloc(256,sizeof(char));
+  sedexpr->arg2 = mem_calloc(256,sizeof(uint8_t));
   reliq_cstr first = sedexpr->arg;
   size_t i=0,j=0;
 
@@ -515,9 +516,9 @@ sed_comp_s(const char *src, const size_t pos, int eflags, struct sed_expression
   splchars_conv(tmp,&len);
   tmp[len] = 0;
 
-  sedexpr->arg1 = malloc(sizeof(regex_t));
+  sedexpr->arg1 = mem_alloc(sizeof(regex_t));
   if (regcomp(sedexpr->arg1,tmp,eflags)) {
-    free(sedexpr->arg1);
+    mem_free(sedexpr->arg1);
     sedexpr->arg1 = NULL;
     return script_err("sed: char %lu: couldn't compile regex",sedexpr->arg.b-src);
   }
@@ -1030,12 +1031,12 @@ sed_edit(const reliq_cstr *src, SINK *output, const edit_args *args)
 
   char *buffers[3];
   for (size_t i = 0; i < 3; i++)
-    buffers[i] = malloc(SED_MAX_PATTERN_SPACE);
+    buffers[i] = mem_alloc(SED_MAX_PATTERN_SPACE);
 
   err = sed_pre_edit(src->b,src->s,output,buffers,&script,linedelim,silent);
 
   for (size_t i = 0; i < 3; i++)
-    free(buffers[i]);
+    mem_free(buffers[i]);
   sed_script_free(&script);
   return err;
 }
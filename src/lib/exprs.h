@@ -46,6 +46,8 @@
 #include "fields.h"
 #include "output.h"
 
+struct reliq_nmemo;
+
 struct reliq_expr {
   reliq_field outfield;
   void *e; //either points to flexarr*(reliq_expr) or reliq_npattern
@@ -55,12 +57,21 @@ struct reliq_expr {
   size_t exprfl;
   uint16_t childfields; //amount of fields under this expr
   uint16_t childformats; //amount of formats under this expr
+  const reliq_allocator *allocator; //set only in expression returned by reliq_ecomp()
   uint8_t flags; //EXPR_
 };
 
 reliq_error *reliq_exec_r(const reliq *rq, const reliq_compressed *input, const size_t inputl, const reliq_expr *expr, SINK *output, reliq_compressed **outnodes, size_t *outnodesl);
 
 reliq_error *expr_check_chain(const reliq_expr *expr);
+bool expr_uses_parent(const reliq_expr *expr); //returns 1 if result of expr can depend on parents of input nodes
+
+/*
+  returns 1 if expr finds any node, expr has to pass expr_check_chain(),
+  errors are treated as if nothing was found. memo is the one of execution
+  that expr is nested in.
+*/
+bool reliq_exec_any(const reliq *rq, struct reliq_nmemo *memo, const reliq_compressed *input, const reliq_expr *expr);
 
 void reliq_efree_intr(reliq_expr *expr);
 reliq_error *reliq_ecomp_intr(const char *src, const size_t size, reliq_expr *expr);
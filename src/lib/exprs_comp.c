@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include <assert.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "utils.h"
 #include "npattern.h"
@@ -48,7 +49,7 @@ reliq_expr_free_pre(flexarr *exprs) //exprs: reliq_expr
   for (size_t i = 0; i < size; i++)
     reliq_efree_intr(&e[i]);
   flexarr_free(exprs);
-  free(exprs);
+  mem_free(exprs);
 }
 
 void
@@ -62,15 +63,37 @@ reliq_efree_intr(reliq_expr *expr)
     reliq_expr_free_pre(expr->e);
   } else {
     reliq_nfree((reliq_npattern*)expr->e);
-    free(expr->e);
+    mem_free(expr->e);
   }
 }
 
 void
 reliq_efree(reliq_expr *expr)
 {
+  const reliq_allocator *prev = reliq_get_allocator();
+  reliq_set_allocator(expr->allocator);
   reliq_efree_intr(expr);
-  free(expr);
+  mem_free(expr);
+  reliq_set_allocator(prev);
+}
+
+uint8_t
+reliq_expr_skip(const reliq_expr *expr)
+{
+  uint8_t skip = format_skip(expr->nodef,expr->nodefl)
+    &format_skip(expr->exprf,expr->exprfl);
+
+  if (EXPR_IS_TABLE(expr->flags)) {
+    const flexarr *exprs = expr->e; //reliq_expr
+    if (!exprs)
+      return skip;
+    const reliq_expr *e = (reliq_expr*)exprs->v;
+    const size_t size = exprs->size;
+    for (size_t i = 0; i < size && skip; i++)
+      skip &= reliq_expr_skip(&e[i]);
+  } else if (expr->e)
+    skip &= reliq_nskip((reliq_npattern*)expr->e);
+  return skip;
 }
 
 #ifdef EXPR_DEBUG
@@ -665,7 +688,7 @@ add_chainlink(flexarr *exprs, reliq_expr *cl, const bool noerr) //exprs: reliq_e
 
   if (cl->e == NULL) {
     EXPR_TYPE_SET(cl->flags,EXPR_NPATTERN);
-    cl->e = malloc(sizeof(reliq_npattern));
+    cl->e = mem_alloc(sizeof(reliq_npattern));
     assert(reliq_ncomp(NULL,0,cl->e) == NULL);
   }
 
@@ -921,9 +944,9 @@ tcomp_text(size_t *pos, tcomp_state *st)
   st->lasttext_nonempty = 1;
   EXPR_TYPE_SET(expr->flags,EXPR_NPATTERN);
 
-  expr->e = malloc(sizeof(reliq_npattern));
+  expr->e = mem_alloc(sizeof(reliq_npattern));
   if ((err = reliq_ncomp(start,len,(reliq_npattern*)expr->e))) {
-    free(expr->e);
+    mem_free(expr->e);
     expr->e = NULL;
   }
   return err;
@@ -1110,8 +1133,8 @@ tokens_free(token *tokens, const size_t tokensl)
 {
   for (size_t i = 0; i < tokensl; i++)
     if (tokens[i].name == tText)
-      free((void*)tokens[i].start);
-  free(tokens);
+      mem_free((void*)tokens[i].start);
+  mem_free(tokens);
 }
 
 reliq_error *
@@ -1162,6 +1185,7 @@ reliq_ecomp(const char *src, const size_t size, reliq_expr **expr)
   reliq_error *err = reliq_ecomp_intr(src,size,&e);
   if (err)
     return err;
+  e.allocator = reliq_get_allocator();
   *expr = memdup(&e,sizeof(reliq_expr));
   return NULL;
 }
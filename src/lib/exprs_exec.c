@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include <assert.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "utils.h"
 #include "npattern.h"
@@ -32,6 +33,8 @@
 #include "format.h"
 #include "exprs.h"
 #include "node_exec.h"
+#include "index.h"
+#include "npattern_intr.h"
 
 #define PASSED_INC -(1<<8) //!! if increased causes huge allocation
 #define NCOLLECTOR_INC -(1<<8)
@@ -43,13 +46,22 @@ typedef struct {
   flexarr *ncollector; //struct ncollector
   flexarr *fcollector; //struct fcollector
   flexarr *out; //reliq_compressed
+  flexarr *firsts; //struct exec_first, can be NULL
+  reliq_nmemo *memo; //results of has@ hooks, shared with nested executions
   bool isempty : 1;
   bool noncol : 1; //no ncollector
   bool something_found : 1;
   bool something_failed : 1;
 } exec_state;
 
+//results of node pattern executed on the whole document, see reliq_exec_multi()
+struct exec_first {
+  const reliq_npattern *nodep;
+  flexarr nodes; //reliq_compressed
+};
+
 static reliq_error *exec_chain(const reliq_expr *expr, const flexarr *source, flexarr *dest, exec_state *st); //source: reliq_compressed, dest: reliq_compressed
+static reliq_error *exec_r(const reliq *rq, const reliq_compressed *input, const size_t inputl, const reliq_expr *expr, flexarr *firsts, reliq_nmemo *memo, SINK *output, reliq_compressed **outnodes, size_t *outnodesl); //firsts: struct exec_first
 
 static inline void
 add_compressed_blank(flexarr *dest, const enum outfieldCode val1, const void *val2) //dest: reliq_compressed
@@ -88,6 +100,115 @@ expr_check_chain(const reliq_expr *expr)
   return script_err("expression is not a chain");
 }
 
+bool
+expr_uses_parent(const reliq_expr *expr)
+{
+  if (!EXPR_IS_TABLE(expr->flags))
+    return (expr->e && ((reliq_npattern*)expr->e)->flags&N_PARENT);
+
+  const flexarr *exprs = expr->e; //reliq_expr
+  if (!exprs)
+    return 0;
+  const reliq_expr *e = (reliq_expr*)exprs->v;
+  const size_t size = exprs->size;
+  for (size_t i = 0; i < size; i++)
+    if (expr_uses_parent(&e[i]))
+      return 1;
+  return 0;
+}
+
+static inline bool
+expr_plain(const reliq_expr *expr)
+{
+  return (!expr->e || expr->nodefl || expr->exprfl || expr->outfield.isset) ? 0 : 1;
+}
+
+//returns chain of node patterns of expr passing expr_check_chain(), or NULL if something else than nodes could be found
+static const flexarr *
+expr_plain_chain(const reliq_expr *expr) //returns flexarr*(reliq_expr)
+{
+  if (!expr_plain(expr))
+    return NULL;
+  const flexarr *v = expr->e; //reliq_expr
+  if (v->size != 1)
+    return NULL;
+  const reliq_expr *chain = &((reliq_expr*)v->v)[0];
+  if (!expr_plain(chain))
+    return NULL;
+
+  const flexarr *exprs = chain->e; //reliq_expr
+  const reliq_expr *e = (reliq_expr*)exprs->v;
+  const size_t size = exprs->size;
+  if (!size)
+    return NULL;
+  for (size_t i = 0; i < size; i++)
+    if (!expr_plain(&e[i]))
+      return NULL;
+  return exprs;
+}
+
+bool
+reliq_exec_any(const reliq *rq, reliq_nmemo *memo, const reliq_compressed *input, const reliq_expr *expr)
+{
+  const flexarr *chain = expr_plain_chain(expr); //reliq_expr
+  if (!chain) {
+    size_t compressedl = 0;
+    reliq_error *err = exec_r(rq,input,1,expr,NULL,memo,NULL,NULL,&compressedl);
+    if (err) {
+      mem_free(err);
+      return 0;
+    }
+    return (compressedl != 0);
+  }
+
+  const reliq_expr *exprs = chain->v;
+  const size_t last = chain->size-1;
+  flexarr src = flexarr_init(sizeof(reliq_compressed),PASSED_INC);
+  flexarr dest = flexarr_init(sizeof(reliq_compressed),PASSED_INC);
+  *(reliq_compressed*)flexarr_inc(&src) = *input;
+  bool found = 1;
+
+  for (size_t i = 0; i < last && found; i++) {
+    node_exec(rq,memo,(reliq_npattern*)exprs[i].e,&src,&dest);
+    found = (dest.size != 0);
+
+    flexarr tmp = src;
+    src = dest;
+    dest = tmp;
+    dest.size = 0;
+  }
+  if (found)
+    found = node_exec_any(rq,memo,(reliq_npattern*)exprs[last].e,&src);
+
+  flexarr_free(&src);
+  flexarr_free(&dest);
+  return found;
+}
+
+static void
+exec_node(const reliq_npattern *nodep, const flexarr *source, flexarr *dest, const exec_state *st) //source: reliq_compressed, dest: reliq_compressed
+{
+  const flexarr *firsts = st->firsts;
+  if (firsts && !source->size) {
+    struct exec_first *f = (struct exec_first*)firsts->v;
+    const size_t size = firsts->size;
+    for (size_t i = 0; i < size; i++) {
+      if (f[i].nodep != nodep)
+        continue;
+      //results are used once, if nodep is executed again they're found anew
+      f[i].nodep = NULL;
+      if (!dest->size) {
+        flexarr tmp = *dest;
+        *dest = f[i].nodes;
+        f[i].nodes = tmp;
+      } else
+        flexarr_add(dest,&f[i].nodes);
+      return;
+    }
+  }
+  node_exec(st->rq,st->memo,nodep,source,dest);
+}
+
 /*static reliq_error *
 ncollector_check(flexarr *ncollector, size_t correctsize) //ncollector: struct ncollector
 {
@@ -397,7 +518,7 @@ exec_chain(const reliq_expr *expr, const flexarr *source, flexarr *dest, exec_st
 
       if (!st->isempty) {
         size_t prevsize = desttemp.size;
-        node_exec(st->rq,nodep,src,&desttemp);
+        exec_node(nodep,src,&desttemp,st);
         if (desttemp.size-prevsize == 0) {
           something_failed = 1;
         } else
@@ -445,8 +566,9 @@ exec_chain(const reliq_expr *expr, const flexarr *source, flexarr *dest, exec_st
   return err;
 }
 
-reliq_error *
-reliq_exec_r(const reliq *rq, const reliq_compressed *input, const size_t inputl, const reliq_expr *expr, SINK *output, reliq_compressed **outnodes, size_t *outnodesl)
+//if memo is NULL results of has@ hooks are remembered only during this call
+static reliq_error *
+exec_r(const reliq *rq, const reliq_compressed *input, const size_t inputl, const reliq_expr *expr, flexarr *firsts, reliq_nmemo *memo, SINK *output, reliq_compressed **outnodes, size_t *outnodesl) //firsts: struct exec_first
 {
   if (!expr)
     return NULL;
@@ -456,12 +578,20 @@ reliq_exec_r(const reliq *rq, const reliq_compressed *input, const size_t inputl
   flexarr ncollector = flexarr_init(sizeof(struct ncollector),NCOLLECTOR_INC);
   flexarr fcollector = flexarr_init(sizeof(struct fcollector),FCOLLECTOR_INC);
 
+  reliq_nmemo ownmemo;
+  if (!memo) {
+    ownmemo = reliq_nmemo_init();
+    memo = &ownmemo;
+  }
+
   exec_state state = {
     .rq = rq,
     .output = output,
     .ncollector = &ncollector,
     .fcollector = &fcollector,
     .out = &compressed,
+    .firsts = firsts,
+    .memo = memo,
   };
 
   flexarr *src = NULL;
@@ -485,6 +615,98 @@ reliq_exec_r(const reliq *rq, const reliq_compressed *input, const size_t inputl
 
   flexarr_free(&ncollector);
   flexarr_free(&fcollector);
+  if (memo == &ownmemo)
+    reliq_nmemo_free(&ownmemo);
+  return err;
+}
+
+reliq_error *
+reliq_exec_r(const reliq *rq, const reliq_compressed *input, const size_t inputl, const reliq_expr *expr, SINK *output, reliq_compressed **outnodes, size_t *outnodesl)
+{
+  return exec_r(rq,input,inputl,expr,NULL,NULL,output,outnodes,outnodesl);
+}
+
+/*
+  Adds node patterns that are executed with empty source, i.e. on the whole
+  document, when expr is executed without input. These are first patterns of
+  chains in expr and in blocks starting such chains.
+*/
+static void
+exec_firsts_add(const reliq_expr *expr, flexarr *firsts) //firsts: struct exec_first
+{
+  const flexarr *exprs = expr->e; //reliq_expr
+  if (!exprs)
+    return;
+  const reliq_expr *e = (reliq_expr*)exprs->v;
+  const size_t size = exprs->size;
+  for (size_t i = 0; i < size; i++) {
+    if (EXPR_TYPE_IS(e[i].flags,EXPR_BLOCK_CONDITION)) {
+      exec_firsts_add(&e[i],firsts);
+      continue;
+    }
+
+    const flexarr *chain = e[i].e; //reliq_expr
+    if (!chain->size)
+      continue;
+    const reliq_expr *first = (reliq_expr*)chain->v;
+    if (EXPR_IS_TABLE(first->flags)) {
+      //singular blocks are executed for each input node so they aren't run on empty source
+      if (!EXPR_TYPE_IS(first->flags,EXPR_SINGULAR))
+        exec_firsts_add(first,firsts);
+    } else if (first->e)
+      *(struct exec_first*)flexarr_inc(firsts) = (struct exec_first){
+        .nodep = first->e,
+        .nodes = flexarr_init(sizeof(reliq_compressed),PASSED_INC)
+      };
+  }
+}
+
+reliq_error *
+reliq_exec_multi(const reliq *rq, const reliq_expr *const *exprs, const size_t exprsl, char **strs, size_t *strsl)
+{
+  for (size_t i = 0; i < exprsl; i++) {
+    strs[i] = NULL;
+    strsl[i] = 0;
+  }
+
+  //results of has@ hooks are shared by all expressions and the first scan
+  reliq_nmemo memo = reliq_nmemo_init();
+
+  flexarr firsts = flexarr_init(sizeof(struct exec_first),FCOLLECTOR_INC);
+  for (size_t i = 0; i < exprsl; i++)
+    if (exprs[i])
+      exec_firsts_add(exprs[i],&firsts);
+
+  //the whole document is scanned once for all expressions
+  struct exec_first *f = (struct exec_first*)firsts.v;
+  const size_t firstsl = firsts.size;
+  if (firstsl) {
+    const reliq_npattern **nodeps = mem_alloc(firstsl*sizeof(reliq_npattern*));
+    flexarr *dests = mem_alloc(firstsl*sizeof(flexarr));
+    for (size_t i = 0; i < firstsl; i++) {
+      nodeps[i] = f[i].nodep;
+      dests[i] = f[i].nodes;
+    }
+    node_exec_first_multi(rq,&memo,nodeps,firstsl,dests);
+    for (size_t i = 0; i < firstsl; i++)
+      f[i].nodes = dests[i];
+    mem_free(nodeps);
+    mem_free(dests);
+  }
+
+  reliq_error *err = NULL;
+  for (size_t i = 0; i < exprsl && !err; i++) {
+    if (!exprs[i])
+      continue;
+    SINK output = sink_open(strs+i,strsl+i);
+    err = exec_r(rq,NULL,0,exprs[i],&firsts,&memo,&output,NULL,NULL);
+    sink_close(&output);
+  }
+
+  reliq_nmemo_free(&memo);
+  for (size_t i = 0; i < firstsl; i++)
+    flexarr_free(&f[i].nodes);
+  flexarr_free(&firsts);
   return err;
 }
 
@@ -18,6 +18,7 @@
 
 #include "../ext.h"
 
+#include "alloc.h"
 #include "utils.h"
 #include "fields.h"
 #include "output.h"
@@ -117,7 +118,7 @@ reliq_field_type_args_free(struct reliq_field_type_arg *args, const size_t argsl
 {
   for (size_t i = 0; i < argsl; i++) {
     if (args[i].type == RELIQ_FIELD_TYPE_ARG_STR)
-      free(args[i].v.s.b);
+      mem_free(args[i].v.s.b);
   }
 }
 
@@ -730,11 +731,11 @@ static void
 reliq_field_type_free(reliq_field_type *type)
 {
   if (type->name.b)
-    free(type->name.b);
+    mem_free(type->name.b);
 
   if (type->args) {
     reliq_field_type_args_free(type->args,type->argsl);
-    free(type->args);
+    mem_free(type->args);
   }
 
   reliq_field_types_free(type->subtypes,type->subtypesl);
@@ -748,7 +749,7 @@ reliq_field_types_free(reliq_field_type *types, const size_t typesl)
 
   for (size_t i = 0; i < typesl; i++)
     reliq_field_type_free(types+i);
-  free(types);
+  mem_free(types);
 }
 
 static reliq_error *outfield_type_get(const char *src, size_t *pos, const size_t size, reliq_field_type **types, size_t *typesl, const bool isarray);
@@ -941,7 +942,7 @@ outfields_print_pre(const reliq *rq, struct outfield **fields, size_t *pos, cons
       if (field->o)
         outfields_value_print(rq,out,field->o->types,field->o->typesl,field->v,field->s,field->notempty);
       if (field->v)
-        free(field->v);
+        mem_free(field->v);
       field->s = 0;
     } else if (field->code == ofBlock || field->code == ofArray) {
       i++;
@@ -970,9 +971,9 @@ void
 reliq_field_free(reliq_field *outfield)
 {
   if (outfield->name.b)
-    free(outfield->name.b);
+    mem_free(outfield->name.b);
   if (outfield->annotation.b)
-    free(outfield->annotation.b);
+    mem_free(outfield->annotation.b);
 
   reliq_field_types_free(outfield->types,outfield->typesl);
 }
@@ -986,8 +987,8 @@ outfields_free(flexarr *outfields) //struct outfield*
     if (outfieldsv[i]->f.type)
       sink_close(&outfieldsv[i]->f);
     if (outfieldsv[i]->s)
-      free(outfieldsv[i]->v);
-    free(outfieldsv[i]);
+      mem_free(outfieldsv[i]->v);
+    mem_free(outfieldsv[i]);
   }
   flexarr_free(outfields);
 }
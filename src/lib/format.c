@@ -19,6 +19,7 @@
 #include "../ext.h"
 
 #include <stdlib.h>
+#include "alloc.h"
 #include "edit.h"
 #include "range.h"
 #include "hnode_print.h"
@@ -135,6 +136,17 @@ format_exec(char *input, size_t inputl, SINK *output, const reliq_chnode *hnode,
   return err;
 }
 
+uint8_t
+format_skip(const reliq_format_func *format, const size_t formatl)
+{
+  if (!formatl || format[0].flags&FORMAT_FUNC)
+    return RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY|RELIQ_SKIP_COMMENTS;
+  const reliq_cstr *str = format[0].arg[0];
+  if (!str)
+    return RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY|RELIQ_SKIP_COMMENTS;
+  return chnode_printf_skip(str->b,str->s);
+}
+
 static reliq_error *
 format_get_func_args(reliq_format_func *f, const char *src, size_t *pos, const size_t size, size_t *argcount)
 {
@@ -151,7 +163,7 @@ format_get_func_args(reliq_format_func *f, const char *src, size_t *pos, const s
         goto END;
 
       if (resultl) {
-        reliq_str *str = f->arg[arg] = malloc(sizeof(reliq_str));
+        reliq_str *str = f->arg[arg] = mem_alloc(sizeof(reliq_str));
         str->b = result;
         str->s = resultl;
         f->flags |= (FORMAT_ARG0_ISSTR<<arg);
@@ -244,13 +256,13 @@ format_free(reliq_format_func *format, const size_t formatl)
 
       if (format[i].flags&(FORMAT_ARG0_ISSTR<<j)) {
         if (((reliq_str*)format[i].arg[j])->b)
-          free(((reliq_str*)format[i].arg[j])->b);
+          mem_free(((reliq_str*)format[i].arg[j])->b);
       } else
         range_free((reliq_range*)format[i].arg[j]);
-      free(format[i].arg[j]);
+      mem_free(format[i].arg[j]);
     }
   }
-  free(format);
+  mem_free(format);
 }
 
 reliq_error *
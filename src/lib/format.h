@@ -35,6 +35,8 @@ struct reliq_format_func {
 typedef struct reliq_format_func reliq_format_func;
 
 reliq_error *format_exec(char *input, size_t inputl, SINK *output, const reliq_chnode *hnode, const reliq_chnode *parent, const reliq_format_func *format, const size_t formatl, const reliq *rq);
+//returns RELIQ_SKIP_ of nodes that don't change output of format
+uint8_t format_skip(const reliq_format_func *format, const size_t formatl);
 void format_free(reliq_format_func *format, const size_t formatl);
 
 reliq_error *format_comp(const char *src, size_t *pos, const size_t size, reliq_format_func **format, size_t *formatl);
@@ -17,6 +17,10 @@
 */
 
 #include "../ext.h"
+
+#include <string.h>
+
+#include "ctype.h"
 #include "reliq.h"
 
 inline uint32_t
@@ -45,7 +49,43 @@ reliq_chnode_type(const reliq_chnode *c)
   return RELIQ_HNODE_TYPE_TEXT;
 }
 
-inline uint32_t
+/*
+  Finds end of starting tag of hnode that has ending tag, it's needed
+  when skipped nodes could be at the beginning of its insides. Between
+  the last attribute and '>' there can be only whitespace and '/'.
+*/
+static reliq_off
+starttag_end(const reliq *rq, const reliq_chnode *hnode, const reliq_off base)
+{
+  reliq_off i = base;
+  const uint32_t attribsl = reliq_chnode_attribsl(rq,hnode);
+  if (attribsl) {
+    const reliq_cattrib *a = rq->attribs+hnode->attribs+attribsl-1;
+    i = a->key+a->keyl+a->value+a->valuel;
+  }
+
+  const reliq_off endtag = base+hnode->endtag;
+  if (i >= endtag)
+    return hnode->endtag;
+  const char *end = memchr(rq->data+i,'>',endtag-i);
+  if (!end)
+    return hnode->endtag;
+  return end-(rq->data+base)+1;
+}
+
+#ifdef RELIQ_PHPTAGS
+static bool
+is_phptag(const reliq *rq, const reliq_chnode *hnode)
+{
+  const char *f = rq->data+hnode->all;
+  reliq_off i = hnode->tag-1;
+  while (i && isspace(f[i]))
+    i--;
+  return (f[i] == '?');
+}
+#endif
+
+inline reliq_off
 reliq_chnode_insides(const reliq *rq, const reliq_chnode *hnode, const uint8_t type)
 {
   if (type == RELIQ_HNODE_TYPE_COMMENT)
@@ -53,12 +93,24 @@ reliq_chnode_insides(const reliq *rq, const reliq_chnode *hnode, const uint8_t t
   if (type != RELIQ_HNODE_TYPE_TAG)
     return 0;
 
-  const uint32_t base = hnode->all+hnode->tag+hnode->tagl;
+  const reliq_off base = hnode->all+hnode->tag+hnode->tagl;
   if (hnode->tag_count+hnode->text_count+hnode->comment_count == 0) {
+    if (unlikely(rq->skipped)
+      #ifdef RELIQ_PHPTAGS
+      && !is_phptag(rq,hnode)
+      #endif
+      ) {
+      //anything between starting and ending tag could only be skipped
+      const reliq_off end = starttag_end(rq,hnode,base);
+      if (end < hnode->endtag)
+        return end;
+    }
     if (rq->data[base+hnode->endtag] == '<')
       return hnode->endtag;
     return 0;
   }
+  if (unlikely(rq->skipped))
+    return starttag_end(rq,hnode,base);
   const reliq_chnode *next = hnode+1;
 
   return next->all-base;
@@ -79,7 +131,7 @@ reliq_chnode_conv(const reliq *rq, const reliq_chnode *c, reliq_hnode *d)
   } else
     d->tag = (reliq_cstr){ .b = NULL, .s = 0 };
 
-  const uint32_t insides = reliq_chnode_insides(rq,c,type);
+  const reliq_off insides = reliq_chnode_insides(rq,c,type);
   if (insides == 0 && c->endtag == 0) {
     d->insides = (reliq_cstr){NULL,0};
   } else {
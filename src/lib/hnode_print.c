@@ -20,6 +20,7 @@
 
 #include <stdlib.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "entities.h"
 #include "utils.h"
@@ -131,7 +132,7 @@ print_text(const reliq *rq, const reliq_chnode *hnode, uint8_t flags, SINK *outf
     size_t ptrl_r;
     memtrim(&ptr_r,&ptrl_r,ptr,ptrl);;
     sink_write(outfile,ptr_r,ptrl_r);
-    free(ptr);
+    mem_free(ptr);
   }
 }
 
@@ -257,6 +258,52 @@ chnode_printf(SINK *outfile, const char *format, const size_t formatl, const rel
   }
 }
 
+uint8_t
+chnode_printf_skip(const char *format, const size_t formatl)
+{
+  uint8_t skip = RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY|RELIQ_SKIP_COMMENTS;
+  size_t i = 0;
+  while (i < formatl) {
+    if (format[i++] != '%')
+      continue;
+    if (i >= formatl)
+      break;
+    if (isdigit(format[i])) {
+      while (i < formatl && isdigit(format[i]))
+        i++;
+    } else if (format[i] == '(') {
+      char *t = memchr(format+i,')',formatl-i);
+      if (!t)
+        break;
+      i = t-format+1;
+    }
+    while (i < formatl && (format[i] == 'U' || format[i] == 'D'))
+      i++;
+    if (i >= formatl)
+      break;
+
+    switch (format[i++]) {
+      case 't':
+      case 'T':
+        skip &= ~(RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY);
+        break;
+      case 'C':
+        if (i < formatl && format[i] == 'c') {
+          skip &= ~RELIQ_SKIP_COMMENTS;
+        } else if (i < formatl && format[i] == 't') {
+          skip &= ~(RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY);
+        } else
+          skip = 0;
+        break;
+      case 'p':
+      case 'P':
+        skip = 0;
+        break;
+    }
+  }
+  return skip;
+}
+
 void
 chnode_print(SINK *outfile, const reliq_chnode *chnode, const reliq *rq)
 {
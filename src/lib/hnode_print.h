@@ -22,6 +22,8 @@
 #include "types.h"
 
 void chnode_printf(SINK *outfile, const char *format, const size_t formatl, const reliq_chnode *chnode, const reliq_chnode *parent, const reliq *rq);
+//returns RELIQ_SKIP_ of nodes that don't change output of chnode_printf() with format
+uint8_t chnode_printf_skip(const char *format, const size_t formatl);
 void chnode_print(SINK *outfile, const reliq_chnode *chnode, const reliq *rq);
 
 #endif
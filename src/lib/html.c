@@ -20,74 +20,105 @@
 
 #include <stdlib.h>
 #include <string.h>
+#ifdef RELIQ_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
+#include "alloc.h"
 #include "ctype.h"
 #include "utils.h"
 #include "npattern.h"
+#include "scan.h"
+#include "tags.h"
+#include "index.h"
 #include "html.h"
 
 #define ATTRIB_INC -(1<<13)
 #define NODES_INC -(1<<13)
+#define FRAMES_INC -(1<<6)
+#define ATOMS_INC -(1<<12)
+#define NAMES_BUCKETS 64
+#define ESTIMATE_SAMPLE (1<<12)
+#define ESTIMATE_SAMPLES 64
+
+#ifdef RELIQ_THREADS
+#define PARALLEL_MIN_SIZE (1<<23) //documents smaller than that are parsed sequentially
+#define PARALLEL_CHUNK_MIN (1<<21)
+#define PARALLEL_MAX_THREADS 16
+#endif
 
-const cstr8 selfclosing_s[] = { //tags that don't end with </tag>
-  {"br",2},{"img",3},{"input",5},{"link",4},
-  {"meta",4},{"hr",2},{"col",3},{"embed",5},
-  {"area",4},{"base",4},{"param",5},
-  {"source",6},{"track",5},{"wbr",3},{"command",7},
-  {"keygen",6},{"menuitem",8}
-};
+static const uint8_t tag_flags[TAG_COUNT] = {
+  [TAG_BR] = TAGF_SELFCLOSING, [TAG_IMG] = TAGF_SELFCLOSING,
+  [TAG_INPUT] = TAGF_SELFCLOSING, [TAG_LINK] = TAGF_SELFCLOSING,
+  [TAG_META] = TAGF_SELFCLOSING, [TAG_HR] = TAGF_SELFCLOSING,
+  [TAG_COL] = TAGF_SELFCLOSING, [TAG_EMBED] = TAGF_SELFCLOSING,
+  [TAG_AREA] = TAGF_SELFCLOSING, [TAG_BASE] = TAGF_SELFCLOSING,
+  [TAG_PARAM] = TAGF_SELFCLOSING, [TAG_SOURCE] = TAGF_SELFCLOSING,
+  [TAG_TRACK] = TAGF_SELFCLOSING, [TAG_WBR] = TAGF_SELFCLOSING,
+  [TAG_COMMAND] = TAGF_SELFCLOSING, [TAG_KEYGEN] = TAGF_SELFCLOSING,
+  [TAG_MENUITEM] = TAGF_SELFCLOSING,
 
-const cstr8 script_s[] = { //tags which insides should be ommited
-  {"script",6},{"style",5}
+  [TAG_SCRIPT] = TAGF_SCRIPT, [TAG_STYLE] = TAGF_SCRIPT,
+
+  #ifdef RELIQ_AUTOCLOSING
+  [TAG_P] = TAGF_AUTOCLOSING, [TAG_LI] = TAGF_AUTOCLOSING,
+  [TAG_TR] = TAGF_AUTOCLOSING, [TAG_TD] = TAGF_AUTOCLOSING,
+  [TAG_TH] = TAGF_AUTOCLOSING, [TAG_DT] = TAGF_AUTOCLOSING,
+  [TAG_DD] = TAGF_AUTOCLOSING, [TAG_TABLE] = TAGF_AUTOCLOSING|TAGF_INESCAPABLE,
+  [TAG_THEAD] = TAGF_AUTOCLOSING, [TAG_TBODY] = TAGF_AUTOCLOSING,
+  [TAG_TFOOT] = TAGF_AUTOCLOSING, [TAG_RT] = TAGF_AUTOCLOSING,
+  [TAG_RP] = TAGF_AUTOCLOSING, [TAG_OPTGROUP] = TAGF_AUTOCLOSING,
+  [TAG_OPTION] = TAGF_AUTOCLOSING, [TAG_COLGROUP] = TAGF_AUTOCLOSING,
+  #endif
 };
 
 #ifdef RELIQ_AUTOCLOSING
-const cstr8 *autoclosing_s[] = { //tags that don't need to be closed
-  (const cstr8[]){
-    {"p",1},{"p",1},{"div",3},{"ul",2},{"h1",2},
-    {"h2",2},{"h3",2},{"h4",2},{"h5",2},{"h6",2},
-    {"dl",2},{"dd",2},{"dt",2},{"header",6},
-    {"article",7},{"aside",5},{"footer",6},
-    {"hr",2},{"main",4},{"menu",4},{"nav",3},
-    {"ol",2},{"pre",3},{"section",7},{"table",5},
-    {"form",4},{"blockquote",10},{"details",7},
-    {"address",7},{"fieldset",8},{"figcaption",10},
-    {"caption",7},{"figure",6},{"hgroup",6},
-    {"search",6},{NULL,0}
+//autoclosing_s[x][y] is set if tag x is closed by opening of tag y
+static const bool autoclosing_s[TAG_COUNT][TAG_COUNT] = {
+  [TAG_P] = {
+    [TAG_P]=1, [TAG_DIV]=1, [TAG_UL]=1, [TAG_H1]=1, [TAG_H2]=1,
+    [TAG_H3]=1, [TAG_H4]=1, [TAG_H5]=1, [TAG_H6]=1, [TAG_DL]=1,
+    [TAG_DD]=1, [TAG_DT]=1, [TAG_HEADER]=1, [TAG_ARTICLE]=1,
+    [TAG_ASIDE]=1, [TAG_FOOTER]=1, [TAG_HR]=1, [TAG_MAIN]=1,
+    [TAG_MENU]=1, [TAG_NAV]=1, [TAG_OL]=1, [TAG_PRE]=1,
+    [TAG_SECTION]=1, [TAG_TABLE]=1, [TAG_FORM]=1,
+    [TAG_BLOCKQUOTE]=1, [TAG_DETAILS]=1, [TAG_ADDRESS]=1,
+    [TAG_FIELDSET]=1, [TAG_FIGCAPTION]=1, [TAG_CAPTION]=1,
+    [TAG_FIGURE]=1, [TAG_HGROUP]=1, [TAG_SEARCH]=1
   },
-  (const cstr8[]){{"li",2},{"li",2},{NULL,0}},
-  (const cstr8[]){{"tr",2},{"tr",2},{NULL,0}},
-  (const cstr8[]){{"td",2},{"td",2},{"th",2},{NULL,0}},
-  (const cstr8[]){{"th",2},{"th",2},{"td",2},{NULL,0}},
-  (const cstr8[]){{"dt",2},{"dt",2},{"dd",2},{NULL,0}},
-  (const cstr8[]){{"dd",2},{"dd",2},{"dt",2},{NULL,0}},
-  (const cstr8[]){{"table",5},{"table",5},{NULL,0}},
-  (const cstr8[]){{"thead",5},{"tbody",5},{"tfoot",5},{NULL,0}},
-  (const cstr8[]){{"tbody",5},{"tbody",5},{"tfoot",5},{NULL,0}},
-  (const cstr8[]){{"tfoot",5},{"thead",5},{"tbody",5},{NULL,0}},
-  (const cstr8[]){{"rt",2},{"rt",2},{"rp",2},{NULL,0}},
-  (const cstr8[]){{"rp",2},{"rp",2},{"rt",2},{NULL,0}},
-  (const cstr8[]){{"optgroup",8},{"optgroup",8},{"hr",2},{NULL,0}},
-  (const cstr8[]){{"option",6},{"option",6},{"optgroup",8},{"tr",2},{NULL,0}},
-  (const cstr8[]){{"colgroup",8},{"colgroup",8},{NULL,0}},
-};
-
-/* tags from which no closing tag can escape
-   e.g. <div><table></div></table></div> is valid because of it. */
-const cstr8 inescapable_s[] = {
-    {"table",5}
+  [TAG_LI] = {[TAG_LI]=1},
+  [TAG_TR] = {[TAG_TR]=1},
+  [TAG_TD] = {[TAG_TD]=1, [TAG_TH]=1},
+  [TAG_TH] = {[TAG_TH]=1, [TAG_TD]=1},
+  [TAG_DT] = {[TAG_DT]=1, [TAG_DD]=1},
+  [TAG_DD] = {[TAG_DD]=1, [TAG_DT]=1},
+  [TAG_TABLE] = {[TAG_TABLE]=1},
+  [TAG_THEAD] = {[TAG_TBODY]=1, [TAG_TFOOT]=1},
+  [TAG_TBODY] = {[TAG_TBODY]=1, [TAG_TFOOT]=1},
+  [TAG_TFOOT] = {[TAG_THEAD]=1, [TAG_TBODY]=1},
+  [TAG_RT] = {[TAG_RT]=1, [TAG_RP]=1},
+  [TAG_RP] = {[TAG_RP]=1, [TAG_RT]=1},
+  [TAG_OPTGROUP] = {[TAG_OPTGROUP]=1, [TAG_HR]=1},
+  [TAG_OPTION] = {[TAG_OPTION]=1, [TAG_OPTGROUP]=1, [TAG_TR]=1},
+  [TAG_COLGROUP] = {[TAG_COLGROUP]=1},
 };
 #endif
 
 typedef struct {
     flexarr *nodes; //reliq_chnode
     flexarr *attribs; //reliq_cattrib
+    flexarr *frames; //struct html_frame
+    flexarr *atoms; //struct html_atom
+    struct index_names tagnames;
     reliq_error *err;
     const char *f;
-    const size_t s;
+    size_t s;
     uint32_t tag_count;
     uint32_t text_count;
     uint32_t comment_count;
+    uint32_t names[NAMES_BUCKETS]; //index+1 of the latest open element with name in bucket
+    uint8_t skip; //RELIQ_SKIP_
 } html_state;
 
 static void
@@ -103,12 +134,14 @@ comment_handle(const char *f, size_t *pos, const size_t s, reliq_chnode *hn)
     i += 2;
     diff = 2;
     hn->tagl = i-base;
-    while (s-i > diff && (f[i] != '-' || f[i+1] != '-' || f[i+2] != '>'))
-      i++;
+    if (i < s)
+      i = scan_comment_end(f,i,s);
   } else {
     hn->tagl = i-base;
-    while (i < s && f[i] != '>')
-      i++;
+    if (i < s) {
+      char const *end = memchr(f+i,'>',s-i);
+      i = end ? (size_t)(end-f) : s;
+    }
   }
 
   if (s-i > diff) {
@@ -127,11 +160,8 @@ tagname_handle(const char *f, size_t *pos, const size_t s, reliq_cstr *tag)
 {
   size_t i = *pos;
   tag->b = f+i;
-  if (i < s && isalpha(f[i])) {
-    i++;
-    while (i < s && !isspace(f[i]) && f[i] != '>' && f[i] != '/')
-      i++;
-  }
+  if (i < s && isalpha(f[i]))
+    i = scan_tagname_end(f,i+1,s);
   tag->s = (f+i)-tag->b;
   *pos = i;
 }
@@ -141,8 +171,7 @@ attribname_handle(const char *f, size_t *pos, const size_t s, reliq_cattrib *a)
 {
   size_t i = *pos;
   a->key = i;
-  while (i < s && f[i] != '=' && f[i] != '>' && f[i] != '/' && !isspace(f[i]))
-    i++;
+  i = scan_attribname_end(f,i,s);
   a->keyl = i-a->key;
   *pos = i;
 }
@@ -279,27 +308,46 @@ phptag_handle(const char *f, size_t *pos, const size_t s, reliq_chnode *hnode, f
 }
 #endif
 
-#ifdef RELIQ_AUTOCLOSING
-static bool
-isinescapable(reliq_cstr str)
-{
-  for (size_t g = 0; g < LENGTH(inescapable_s); g++)
-    if (strcaseeq(str,inescapable_s[g]))
-      return 1;
-  return 0;
-}
-#endif
-
-static uint32_t html_struct_handle(size_t *pos, const uint16_t lvl, html_state *st);
+struct html_atom {
+  uint32_t node;
+  uint32_t atom;
+};
 
 struct tag_info {
-    #ifdef RELIQ_AUTOCLOSING
-    uint8_t autoclosing;
-    #endif
+    uint8_t tag; //TAG_ from tags.h
     bool foundend : 1;
     bool script : 1;
 };
 
+/*
+  Frame of a single open element, it keeps everything that previously was
+  kept on the call stack by recursion of html_struct_handle()
+*/
+struct html_frame {
+  reliq_cstr tagname;
+  size_t hnindex;
+  size_t start;
+  size_t base;
+  size_t tnindex; //textnode index
+  size_t textstart;
+  size_t textend;
+  size_t tagend;
+  uint32_t fallback;
+  uint32_t htmlerr;
+  uint32_t tag_count;
+  uint32_t text_count;
+  uint32_t comment_count;
+  uint32_t name_prev; //index+1 of previous open element with name in the same bucket
+  #ifdef RELIQ_AUTOCLOSING
+  uint16_t inescapable; //index+1 of the closest inescapable element, including this one
+  #endif
+  uint16_t lvl;
+  uint8_t name_bucket;
+  struct tag_info taginfo;
+  bool starttag_ended : 1;
+  bool opened : 1; //tag has insides and is registered in html_state.names
+};
+
 static inline uint32_t
 last_attrib(const flexarr *attrib) //attrib: reliq_cattrib
 {
@@ -315,10 +363,7 @@ last_attrib(const flexarr *attrib) //attrib: reliq_cattrib
 static bool
 text_is_empty(const char *text, const size_t textl)
 {
-  for (size_t i = 0; i < textl; i++)
-    if (!isspace(text[i]))
-      return 0;
-  return 1;
+  return (scan_nonspace(text,0,textl) == textl);
 }
 
 static void
@@ -339,11 +384,19 @@ text_finish(size_t *tnindex, flexarr *nodes, const size_t textstart, const size_
   *tnindex = -1;
 }
 
+/*
+  Adds text node that starts at textstart unless it's already added. Text
+  continues until text_finish() so it can be empty only if it's empty up
+  to textend, in that case it isn't added if it should be skipped.
+*/
 static void
-text_add(html_state *st, const uint16_t lvl, size_t *tnindex)
+text_add(html_state *st, const uint16_t lvl, size_t *tnindex, const size_t textstart, const size_t textend)
 {
   if (*tnindex != (size_t)-1)
     return;
+  if (unlikely(st->skip&(RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY))
+    && (st->skip&RELIQ_SKIP_TEXT || text_is_empty(st->f+textstart,textend-textstart)))
+    return;
   st->text_count++;
   reliq_chnode *tn = flexarr_incz(st->nodes);
   tn->attribs = last_attrib(st->attribs);
@@ -353,52 +406,73 @@ text_add(html_state *st, const uint16_t lvl, size_t *tnindex)
 
 #ifdef RELIQ_AUTOCLOSING
 static bool
-autocloses(const char *f, size_t pos, const size_t s, const uint8_t autoclosing)
+autocloses(const char *f, size_t pos, const size_t s, const uint8_t tag)
 {
-  if (autoclosing == (uint8_t)-1)
+  if (!(tag_flags[tag]&TAGF_AUTOCLOSING))
     return 0;
 
-  const cstr8 *arr = autoclosing_s[autoclosing];
   reliq_cstr name;
-
   while_is(isspace,f,pos,s);
   tagname_handle(f,&pos,s,&name);
-  if (!name.s)
-    return 0;
+  return autoclosing_s[tag][tag_find(name.b,name.s)];
+}
+#endif
+
+static inline uint8_t
+tagname_bucket(const reliq_cstr name)
+{
+  const char first = name.b[0],
+    last = name.b[name.s-1];
+  return (tolower_inline(first)*7+tolower_inline(last)+name.s)&(NAMES_BUCKETS-1);
+}
 
-  for (uint8_t j = 1; arr[j].b; j++)
-    if (strcaseeq(arr[j],name))
-      return 1;
+static void
+open_element_add(html_state *st, struct html_frame *fr)
+{
+  const uint32_t index = fr-(struct html_frame*)st->frames->v;
+  fr->name_bucket = tagname_bucket(fr->tagname);
+  fr->name_prev = st->names[fr->name_bucket];
+  st->names[fr->name_bucket] = index+1;
+  #ifdef RELIQ_AUTOCLOSING
+  if (tag_flags[fr->taginfo.tag]&TAGF_INESCAPABLE) {
+    fr->inescapable = index+1;
+  } else
+    fr->inescapable = index ? fr[-1].inescapable : 0;
+  #endif
+  fr->opened = 1;
+}
 
-  return 0;
+static inline void
+open_element_remove(html_state *st, const struct html_frame *fr)
+{
+  if (fr->opened)
+    st->names[fr->name_bucket] = fr->name_prev;
 }
-#endif
 
+/*
+  Finds the closest open ancestor named endname. Open elements are found
+  through st->names so only elements whose names share a bucket with endname
+  are visited, and nothing is visited past the closest inescapable ancestor.
+*/
 static bool
-ancestor_ending(const char *f, size_t *pos, reliq_cstr endname, const reliq_chnode *nodesv, const size_t hnindex, reliq_chnode *hnode, const uint16_t lvl, const size_t tagend, const size_t base, uint32_t *fallback)
+ancestor_ending(const html_state *st, size_t *pos, reliq_cstr endname, reliq_chnode *hnode, const uint16_t lvl, const size_t tagend, const size_t base, uint32_t *fallback)
 {
-  for (size_t j = hnindex-1;; j--) {
-    if (nodesv[j].tagl == 0 || nodesv[j].all_len || nodesv[j].lvl >= lvl) {
-      if (!j)
-        break;
+  const struct html_frame *frames = (struct html_frame*)st->frames->v;
+  uint32_t limit = 1;
+  #ifdef RELIQ_AUTOCLOSING
+  if (frames[lvl-1].inescapable)
+    limit = frames[lvl-1].inescapable;
+  #endif
 
+  for (uint32_t j = st->names[tagname_bucket(endname)]; j >= limit; j = frames[j-1].name_prev) {
+    const struct html_frame *anc = frames+j-1;
+    if (anc->lvl >= lvl || !strcaseeq(anc->tagname,endname))
       continue;
-    }
-    reliq_cstr tag = { .b = f+nodesv[j].all+nodesv[j].tag, .s = nodesv[j].tagl };
-    if (strcaseeq(tag,endname)) {
-      *pos = tagend;
-      hnode->endtag = *pos-base;
-      *fallback = lvl-nodesv[j].lvl;
-      return 1;
-    }
 
-    #ifdef RELIQ_AUTOCLOSING
-    if (isinescapable(tag))
-      return 0;
-    #endif
-
-    if (!j || !nodesv[j].lvl)
-      break;
+    *pos = tagend;
+    hnode->endtag = *pos-base;
+    *fallback = lvl-anc->lvl;
+    return 1;
   }
   return 0;
 }
@@ -447,123 +521,17 @@ handle_ending(html_state *st, size_t *pos, reliq_cstr tagname, const size_t hnin
     goto END;
 
   #ifdef RELIQ_AUTOCLOSING
-  if (isinescapable(tagname))
+  if (tag_flags[info->tag]&TAGF_INESCAPABLE)
     goto END;
   #endif
 
-  end = ancestor_ending(f,&i,endname,nodesv,hnindex,hnode,lvl,tagend,base,fallback);
+  end = ancestor_ending(st,&i,endname,hnode,lvl,tagend,base,fallback);
 
   END: ;
   *pos = i;
   return end;
 }
 
-static bool
-tag_insides_handle(size_t *pos, const size_t hnindex, uint32_t *fallback, struct tag_info *taginfo, html_state *st)
-{
-  bool err = 0;
-  const char *f = st->f;
-  const size_t s = st->s;
-  flexarr *nodes = st->nodes; //reliq_chnode
-  size_t i = *pos;
-  reliq_chnode *hnode = ((reliq_chnode*)nodes->v)+hnindex;
-  uint16_t lvl = hnode->lvl;
-  size_t tagend;
-  size_t base = hnode->all+hnode->tag;
-  const flexarr *attribs = st->attribs;
-  reliq_cstr tagname = { .b = f+base, .s = hnode->tagl };
-  base += hnode->tagl;
-  size_t tnindex = -1; //textnode index
-  size_t textstart=0,textend = 0;
-  uint32_t htmlerr = 0;
-
-  for (; i < s; i++) {
-    textstart = i;
-
-    TEXT_REPEAT: ;
-    htmlerr++;
-    while (i < s && f[i] != '<')
-      i++;
-    textend = i;
-
-    if (textstart != i)
-      text_add(st,lvl+1,&tnindex);
-
-    if (i >= s)
-      break;
-
-    FINAL_TAG_END: ;
-    tagend=i;
-    i++;
-    while_is(isspace,f,i,s);
-    if (unlikely(f[i] == '/')) {
-      i++;
-      while_is(isspace,f,i,s);
-
-      if (handle_ending(st,&i,tagname,hnindex,&htmlerr,taginfo,lvl,tagend,base,fallback))
-        goto END;
-      goto TEXT_REPEAT;
-    }
-
-    if (taginfo->script)
-      goto TEXT_REPEAT;
-
-    if (f[i] == '!') {
-      reliq_chnode *hn = flexarr_incz(nodes);
-      hn->lvl = lvl+1;
-      hn->all = tagend;
-      hn->all_len = 0;
-      hn->attribs = last_attrib(attribs);
-      comment_handle(f,&i,s,hn);
-      st->comment_count++;
-      goto CONTINUE;
-    }
-
-    #ifdef RELIQ_AUTOCLOSING
-    if (autocloses(f,i,s,taginfo->autoclosing)) {
-      hnode = ((reliq_chnode*)nodes->v)+hnindex;
-      hnode->endtag = tagend-base;
-      hnode->all_len = tagend-hnode->all;
-      i = tagend-1;
-      goto END;
-    }
-    #endif
-
-    i = tagend;
-    uint32_t nfallback = html_struct_handle(&i,lvl+1,st);
-    if (unlikely(st->err)) {
-      err = 1;
-      htmlerr++;
-      goto END;
-    }
-    hnode = ((reliq_chnode*)nodes->v)+hnindex;
-    if (likely(nfallback)) {
-      if (nfallback == (uint32_t)-1) {
-        goto TEXT_REPEAT;
-      }
-      if (nfallback > 1) {
-        hnode->endtag = i-base;
-        *fallback = nfallback-1;
-        goto END;
-      } else
-        goto FINAL_TAG_END;
-    }
-    *fallback = nfallback;
-
-    CONTINUE: ;
-    text_finish(&tnindex,nodes,textstart,textend,&htmlerr,st->f);
-  }
-
-  END: ;
-  text_finish(&tnindex,nodes,textstart,textend,&htmlerr,st->f);
-
-  if (err)
-    *fallback = 0;
-
-  *pos = i;
-  return err;
-}
-
 static bool
 attribs_handle(const char *f, size_t *pos, const size_t s, reliq_chnode *hnode, flexarr *attribs) //attribs: reliq_cattrib
 {
@@ -604,198 +572,675 @@ attribs_handle(const char *f, size_t *pos, const size_t s, reliq_chnode *hnode,
   return ended;
 }
 
-static bool
-find_tag_info(reliq_cstr tagname, struct tag_info *info)
+static uint8_t
+atom_add(html_state *st, const size_t hnindex, const char *name, const size_t namel)
 {
-  #define search_array(x,y) for (uint8_t _j = 0; _j < (uint8_t)LENGTH(x); _j++) \
-    if (strcaseeq(x[_j],y))
+  struct html_atom *a = flexarr_inc(st->atoms);
+  a->node = hnindex;
+  a->atom = index_names_atom(&st->tagnames,name,namel);
+  return (a->atom < TAG_COUNT) ? a->atom : TAG_OTHER;
+}
 
-  search_array(selfclosing_s,tagname)
-    return 1;
+uint8_t
+html_tag_flags(const uint8_t tag)
+{
+  return tag_flags[tag];
+}
+
+bool
+html_tag_autocloses(const UNUSED uint8_t tag, const UNUSED uint8_t next)
+{
+  #ifdef RELIQ_AUTOCLOSING
+  if (tag_flags[tag]&TAGF_AUTOCLOSING)
+    return autoclosing_s[tag][next];
+  #endif
+  return 0;
+}
 
-  search_array(script_s,tagname) {
+static bool
+find_tag_info(struct tag_info *info)
+{
+  const uint8_t flags = tag_flags[info->tag];
+  if (flags&TAGF_SELFCLOSING)
+    return 1;
+  if (flags&TAGF_SCRIPT)
     info->script = 1;
-    return 0;
-  }
+  return 0;
+}
 
-  #undef search_array
+/*
+  Handles insides of script and style that can end only with their own
+  ending tag, so only '<' followed by '/' or whitespace has to be checked.
+  Text node is the same as if every '<' was visited by html_struct_handle().
+*/
+static void
+raw_insides_handle(html_state *st, struct html_frame *fr, size_t *pos)
+{
+  const char *f = st->f;
+  const size_t s = st->s;
+  size_t i = *pos;
+  if (i >= s)
+    return;
 
-  #ifdef RELIQ_AUTOCLOSING
-  info->autoclosing = -1;
-  for (uint8_t j = 0; j < (uint8_t)LENGTH(autoclosing_s); j++) {
-    if (strcaseeq(autoclosing_s[j][0],tagname)) {
-      info->autoclosing = j;
-      return 0;
+  size_t end = s; //end of text
+  fr->textstart = i;
+  fr->htmlerr++;
+  while (1) {
+    i = scan_endtag(f,i,s);
+    if (i >= s)
+      break;
+
+    size_t j = i+1;
+    while_is(isspace,f,j,s);
+    if (j >= s || f[j] != '/') {
+      i = j;
+      continue;
+    }
+    j++;
+    while_is(isspace,f,j,s);
+
+    fr->tagend = i;
+    if (handle_ending(st,&j,fr->tagname,fr->hnindex,&fr->htmlerr,&fr->taginfo,fr->lvl,fr->tagend,fr->base,&fr->fallback)) {
+      end = i;
+      i = j;
+      break;
     }
+    i = j;
   }
-  #endif
 
-  return 0;
+  //text is erroneous if any '<' was found before its end
+  if (scan_lt(f,fr->textstart,end) < end)
+    fr->htmlerr++;
+  fr->textend = end;
+  if (fr->textstart != end)
+    text_add(st,fr->lvl+1,&fr->tnindex,fr->textstart,end);
+  *pos = (i < s) ? i : s;
 }
 
+/*
+  Handles node at *pos with all of its descendants. Nesting is kept in
+  st->frames instead of the call stack so it's limited only by the size
+  of reliq_chnode.lvl.
+*/
 static uint32_t
-html_struct_handle(size_t *pos, const uint16_t lvl, html_state *st)
+html_struct_handle(size_t *pos, html_state *st)
 {
+  const char *f = st->f;
+  const size_t s = st->s;
+  flexarr *nodes = st->nodes; //reliq_chnode
+  flexarr *attribs = st->attribs; //reliq_cattrib
+  flexarr *frames = st->frames; //struct html_frame
+  struct html_frame *fr;
+  reliq_chnode *hnode = NULL;
   size_t i = *pos;
-  uint32_t fallback = 0;
+  uint16_t lvl = 0;
+  uint32_t ret;
 
+  OPEN: ;
   if (unlikely(lvl >= RELIQ_MAX_NODE_LEVEL)) {
-    st->err = reliq_set_error(RELIQ_ERROR_HTML,"html: %lu: reached %u level of recursion in document",i,lvl);
+    st->err = reliq_set_error(RELIQ_ERROR_HTML,"html: %lu: reached %u level of nesting in document",i,lvl);
     goto ERR;
   }
 
-  const char *f = st->f;
-  const size_t s = st->s;
-  flexarr *nodes = st->nodes;
-  flexarr *attribs = st->attribs;
-
+  fr = flexarr_inc(frames);
+  *fr = (struct html_frame){
+    .start = i,
+    .tnindex = -1,
+    .tag_count = st->tag_count,
+    .text_count = st->text_count,
+    .comment_count = st->comment_count,
+    .lvl = lvl,
+    .taginfo = { .foundend = 1 }
+  };
   const uint32_t attrib_start = attribs->size;
-  struct tag_info taginfo = { .foundend = 1 };
-  size_t start = i;
-
-  const uint32_t tag_count = st->tag_count;
-  const uint32_t text_count = st->text_count;
-  const uint32_t comment_count = st->comment_count;
 
   i++;
   while_is(isspace,f,i,s);
 
   if (unlikely(f[i] == '/')) {
     i++;
-    fallback = (uint32_t)-1;
-    goto ERR;
+    fr->fallback = (uint32_t)-1;
+    goto RETURN;
   }
 
-  reliq_chnode *hnode = flexarr_incz(nodes);
+  hnode = flexarr_incz(nodes);
   hnode->lvl = lvl;
-  hnode->all = start;
+  hnode->all = fr->start;
   hnode->attribs = attrib_start;
-  size_t hnindex = hnode-(reliq_chnode*)nodes->v;
+  fr->hnindex = hnode-(reliq_chnode*)nodes->v;
 
   if (unlikely(f[i] == '!')) {
     hnode->attribs = last_attrib(attribs);
     comment_handle(f,&i,s,hnode);
-    st->comment_count++;
-    goto ERR;
+    if (unlikely(st->skip&RELIQ_SKIP_COMMENTS)) {
+      flexarr_dec(nodes);
+    } else
+      st->comment_count++;
+    goto RETURN;
   }
 
-  bool starttag_ended = 0;
-
   #ifdef RELIQ_PHPTAGS
   if (unlikely(f[i] == '?')) {
-    fallback = phptag_handle(f,&i,s,hnode,nodes);
-    if (fallback == (uint32_t)-1)
-        goto ERR;
+    fr->fallback = phptag_handle(f,&i,s,hnode,nodes);
+    if (fr->fallback == (uint32_t)-1)
+        goto RETURN;
+    atom_add(st,fr->hnindex,f+hnode->all+hnode->tag,hnode->tagl);
 
-    start += hnode->tag;
-    start += hnode->tagl;
+    fr->start += hnode->tag;
+    fr->start += hnode->tagl;
     goto END;
   }
   #endif
 
-  reliq_cstr tagname;
-  tagname_handle(f,&i,s,&tagname);
-  if (!tagname.s) {
+  tagname_handle(f,&i,s,&fr->tagname);
+  if (!fr->tagname.s) {
     flexarr_dec(nodes);
-    fallback = -1;
-    goto ERR;
+    fr->fallback = -1;
+    goto RETURN;
   }
-  start += hnode->tag = tagname.b-f-start;
-  start += hnode->tagl = tagname.s;
+  fr->start += hnode->tag = fr->tagname.b-f-fr->start;
+  fr->start += hnode->tagl = fr->tagname.s;
+  fr->taginfo.tag = atom_add(st,fr->hnindex,fr->tagname.b,fr->tagname.s);
 
   if (i >= s || attribs_handle(f,&i,s,hnode,attribs))
     goto END;
 
-  starttag_ended = (i < s);
+  fr->starttag_ended = (i < s);
 
-  if (find_tag_info(tagname,&taginfo)) {
+  if (find_tag_info(&fr->taginfo)) {
     hnode->all_len = i-hnode->all+1;
     goto END;
   }
 
   i++;
+  fr->base = fr->start;
+  open_element_add(st,fr);
 
-  if (tag_insides_handle(&i,hnindex,&fallback,&taginfo,st)) {
-    flexarr_dec(nodes);
-    goto ERR;
+  if (fr->taginfo.script) {
+    raw_insides_handle(st,fr,&i);
+    goto INSIDES_END;
+  }
+
+  //insides of the tag
+  for (; i < s; i++) {
+    fr->textstart = i;
+
+    TEXT_REPEAT: ;
+    fr->htmlerr++;
+    i = scan_lt(f,i,s);
+    fr->textend = i;
+
+    if (fr->textstart != i)
+      text_add(st,fr->lvl+1,&fr->tnindex,fr->textstart,i);
+
+    if (i >= s)
+      break;
+
+    FINAL_TAG_END: ;
+    fr->tagend = i;
+    i++;
+    while_is(isspace,f,i,s);
+    if (unlikely(f[i] == '/')) {
+      i++;
+      while_is(isspace,f,i,s);
+
+      if (handle_ending(st,&i,fr->tagname,fr->hnindex,&fr->htmlerr,&fr->taginfo,fr->lvl,fr->tagend,fr->base,&fr->fallback))
+        goto INSIDES_END;
+      goto TEXT_REPEAT;
+    }
+
+    if (fr->taginfo.script)
+      goto TEXT_REPEAT;
+
+    if (f[i] == '!') {
+      reliq_chnode *hn = flexarr_incz(nodes);
+      hn->lvl = fr->lvl+1;
+      hn->all = fr->tagend;
+      hn->all_len = 0;
+      hn->attribs = last_attrib(attribs);
+      comment_handle(f,&i,s,hn);
+      if (unlikely(st->skip&RELIQ_SKIP_COMMENTS)) {
+        flexarr_dec(nodes);
+      } else
+        st->comment_count++;
+      goto CONTINUE;
+    }
+
+    #ifdef RELIQ_AUTOCLOSING
+    if (autocloses(f,i,s,fr->taginfo.tag)) {
+      hnode = ((reliq_chnode*)nodes->v)+fr->hnindex;
+      hnode->endtag = fr->tagend-fr->base;
+      hnode->all_len = fr->tagend-hnode->all;
+      i = fr->tagend-1;
+      goto INSIDES_END;
+    }
+    #endif
+
+    i = fr->tagend;
+    lvl = fr->lvl+1;
+    goto OPEN;
+
+    CHILD_RETURN: ;
+    hnode = ((reliq_chnode*)nodes->v)+fr->hnindex;
+    if (likely(ret)) {
+      if (ret == (uint32_t)-1) {
+        goto TEXT_REPEAT;
+      }
+      if (ret > 1) {
+        hnode->endtag = i-fr->base;
+        fr->fallback = ret-1;
+        goto INSIDES_END;
+      } else
+        goto FINAL_TAG_END;
+    }
+    fr->fallback = ret;
+
+    CONTINUE: ;
+    text_finish(&fr->tnindex,nodes,fr->textstart,fr->textend,&fr->htmlerr,f);
   }
 
-  hnode = ((reliq_chnode*)nodes->v)+hnindex;
+  INSIDES_END: ;
+  text_finish(&fr->tnindex,nodes,fr->textstart,fr->textend,&fr->htmlerr,f);
+  hnode = ((reliq_chnode*)nodes->v)+fr->hnindex;
 
   END: ;
   if (i >= s) {
     hnode->all_len = s-hnode->all;
-    if (starttag_ended && hnode->endtag == 0)
-      hnode->endtag = s-start;
+    if (fr->starttag_ended && hnode->endtag == 0)
+      hnode->endtag = s-fr->start;
   } else if (!hnode->all_len) {
     hnode->all_len = i-hnode->all;
-    hnode->endtag = i-start; //!! this doesn't change anything
+    hnode->endtag = i-fr->start; //!! this doesn't change anything
   }
-  if (!taginfo.foundend)
+  if (!fr->taginfo.foundend)
     hnode->endtag = hnode->all_len-hnode->tag-hnode->tagl;
 
-  hnode->tag_count = st->tag_count-tag_count;
-  hnode->text_count = st->text_count-text_count;
-  hnode->comment_count = st->comment_count-comment_count;
+  hnode->tag_count = st->tag_count-fr->tag_count;
+  hnode->text_count = st->text_count-fr->text_count;
+  hnode->comment_count = st->comment_count-fr->comment_count;
 
   st->tag_count++;
 
+  RETURN: ;
+  open_element_remove(st,fr);
+  ret = fr->fallback;
+  flexarr_dec(frames);
+  if (frames->size) {
+    fr = ((struct html_frame*)frames->v)+frames->size-1;
+    goto CHILD_RETURN;
+  }
+
+  *pos = i;
+  return ret;
+
   ERR: ;
+  frames->size = 0;
   *pos = i;
-  return fallback;
+  return 0;
 }
 
-reliq_error *
-html_handle(const char *data, const size_t size, reliq_chnode **nodes, size_t *nodesl, reliq_cattrib **attribs, size_t *attribsl)
+static reliq_index *
+atoms_finish(const flexarr *atoms, const size_t nodesl, struct index_names *tagnames) //atoms: struct html_atom
 {
-  flexarr nodes_buffer = flexarr_init(sizeof(reliq_chnode),NODES_INC);
-  flexarr attribs_buffer = flexarr_init(sizeof(reliq_cattrib),ATTRIB_INC);
-  html_state st = {
-    .f = data,
-    .s = size,
-    .nodes = &nodes_buffer,
-    .attribs = &attribs_buffer,
-  };
+  uint32_t *all = mem_calloc(nodesl,sizeof(uint32_t));
+  const struct html_atom *a = (struct html_atom*)atoms->v;
+  const size_t size = atoms->size;
+  for (size_t i = 0; i < size; i++)
+    all[a[i].node] = a[i].atom;
+  return index_create_from(all,nodesl,tagnames);
+}
+
+/*
+  Estimates counts of '<' and '=' from start to end of f. Big ranges are
+  estimated from evenly spaced samples so that the whole document doesn't
+  have to be read before parsing.
+*/
+static void
+markup_estimate(const char *f, const size_t start, const size_t end, size_t *lt, size_t *eq)
+{
+  const size_t size = end-start;
+  if (size <= ESTIMATE_SAMPLE*ESTIMATE_SAMPLES) {
+    scan_count_markup(f+start,size,lt,eq);
+    return;
+  }
+
+  const size_t step = size/ESTIMATE_SAMPLES;
+  size_t ltc = 0,
+    eqc = 0;
+  for (size_t i = 0; i < ESTIMATE_SAMPLES; i++) {
+    size_t l,e;
+    scan_count_markup(f+start+i*step,ESTIMATE_SAMPLE,&l,&e);
+    ltc += l;
+    eqc += e;
+  }
+  const size_t sampled = ESTIMATE_SAMPLE*ESTIMATE_SAMPLES;
+  *lt = (size/sampled)*ltc+((size%sampled)*ltc)/sampled;
+  *eq = (size/sampled)*eqc+((size%sampled)*eqc)/sampled;
+}
+
+/*
+  Reserves space in buffers for nodes, attribs and atoms of f from start to
+  end. Every '<' can start a tag preceded by a text node, and most attributes
+  have '='. Buffers are shrunk to their sizes by flexarr_conv() at the end
+  anyway.
+*/
+static void
+html_buffers_reserve(html_state *st, const size_t start, const size_t end)
+{
+  size_t lt,eq;
+  markup_estimate(st->f,start,end,&lt,&eq);
+
+  const size_t nodes = lt+(lt>>1)+1;
+  if (nodes > (size_t)-NODES_INC)
+    flexarr_set(st->nodes,nodes);
+  eq += eq>>3;
+  if (eq > (size_t)-ATTRIB_INC)
+    flexarr_set(st->attribs,eq);
+  if (lt > (size_t)-ATOMS_INC)
+    flexarr_set(st->atoms,lt);
+}
+
+/*
+  Handles top level of document starting at i until the beginning of the
+  next iteration is at or after limit, returns position at which it stopped.
+  Every iteration starts with the same state so parsing can be resumed
+  from the returned position by another call.
+*/
+static size_t
+html_range_handle(html_state *st, size_t i, const size_t limit)
+{
+  const char *data = st->f;
+  const size_t size = st->s;
   uint32_t htmlerr = 0;
   size_t tnindex = -1; //textnode index
 
-  for (size_t i = 0; i < size; i++) {
+  for (; i < size && i < limit; i++) {
     size_t textstart=i;
     size_t textend;
 
     TEXT_REPEAT: ;
-    while (i < size && data[i] != '<')
-      i++;
+    i = scan_lt(data,i,size);
     textend = i;
     if (textstart != textend) {
       htmlerr++;
-      text_add(&st,0,&tnindex);
+      text_add(st,0,&tnindex,textstart,textend);
     }
 
     while (i < size && data[i] == '<') {
-      uint32_t r = html_struct_handle(&i,0,&st);
-      if (st.err)
+      uint32_t r = html_struct_handle(&i,st);
+      if (st->err)
         break;
       if (r == (uint32_t)-1)
         goto TEXT_REPEAT;
     }
 
-    text_finish(&tnindex,&nodes_buffer,textstart,textend,&htmlerr,data);
-    if (st.err)
+    text_finish(&tnindex,st->nodes,textstart,textend,&htmlerr,data);
+    if (st->err)
+      break;
+  }
+  return i;
+}
+
+#ifdef RELIQ_THREADS
+/*
+  Large documents are split into chunks that are parsed speculatively in
+  separate threads. Chunk starts are only guessed to be at the top level of
+  document, results of a chunk are used only if parsing of everything before
+  it stopped exactly at its start, otherwise the chunk is parsed again
+  sequentially. Because of that the result is always the same as that of
+  sequential parsing.
+*/
+
+struct html_chunk {
+  struct html_buffers b;
+  html_state st;
+  pthread_t thread;
+  size_t start;
+  size_t limit;
+  size_t end; //position at which parsing stopped
+  bool started : 1;
+};
+
+static void
+html_chunk_init(struct html_chunk *c, const char *data, const size_t size, const uint8_t skip)
+{
+  html_buffers_init(&c->b);
+  c->st = (html_state){
+    .f = data,
+    .s = size,
+    .skip = skip,
+    .nodes = &c->b.nodes,
+    .attribs = &c->b.attribs,
+    .frames = &c->b.frames,
+    .atoms = &c->b.atoms,
+    .tagnames = index_names_init()
+  };
+}
+
+static void
+html_chunk_free(struct html_chunk *c)
+{
+  html_buffers_free(&c->b);
+  index_names_free(&c->st.tagnames);
+  if (c->st.err)
+    mem_free(c->st.err);
+}
+
+static void *
+html_chunk_run(void *arg)
+{
+  struct html_chunk *c = arg;
+  html_buffers_reserve(&c->st,c->start,c->limit);
+  c->end = html_range_handle(&c->st,c->start,c->limit);
+  return NULL;
+}
+
+//appends results of chunk to st fixing indexes of attribs and atoms
+static void
+html_chunk_add(html_state *st, const struct html_chunk *c)
+{
+  const size_t nodes_offset = st->nodes->size;
+  const uint32_t attribs_offset = st->attribs->size;
+
+  flexarr_add(st->nodes,&c->b.nodes);
+  reliq_chnode *nodes = ((reliq_chnode*)st->nodes->v)+nodes_offset;
+  const size_t nodesl = c->b.nodes.size;
+  for (size_t i = 0; i < nodesl; i++)
+    nodes[i].attribs += attribs_offset;
+
+  flexarr_add(st->attribs,&c->b.attribs);
+
+  //interning names in order of their first occurrence in chunk keeps them in order of first occurrence in document
+  const struct index_name *names = (struct index_name*)c->st.tagnames.names.v;
+  const size_t namesl = c->st.tagnames.names.size;
+  uint32_t *map = mem_alloc(namesl*sizeof(uint32_t));
+  for (size_t i = 0; i < namesl; i++)
+    map[i] = index_names_atom(&st->tagnames,names[i].name.b,names[i].name.s);
+
+  const size_t atoms_offset = st->atoms->size;
+  flexarr_add(st->atoms,&c->b.atoms);
+  struct html_atom *atoms = ((struct html_atom*)st->atoms->v)+atoms_offset;
+  const size_t atomsl = c->b.atoms.size;
+  for (size_t i = 0; i < atomsl; i++) {
+    atoms[i].node += nodes_offset;
+    if (atoms[i].atom >= TAG_COUNT)
+      atoms[i].atom = map[atoms[i].atom-TAG_COUNT];
+  }
+  mem_free(map);
+}
+
+/*
+  Returns position after the '>' that precedes the next tag starting a line
+  after i, separated from it only by whitespace, or s if there's none. That's
+  where the top level loop of html_range_handle() starts after ending a top
+  level element.
+*/
+static size_t
+chunk_start(const char *f, size_t i, const size_t s)
+{
+  while (i < s) {
+    const char *nl = memchr(f+i,'\n',s-i);
+    if (!nl)
+      break;
+    i = nl-f+1;
+    if (i+1 >= s || f[i] != '<' || !isalpha(f[i+1]))
+      continue;
+
+    size_t j = i-1;
+    while (j > 0 && isspace(f[j-1]))
+      j--;
+    if (j > 0 && f[j-1] == '>')
+      return j;
+  }
+  return s;
+}
+
+static size_t
+parallel_threads(const size_t size)
+{
+  //allocator set by user doesn't have to be thread safe
+  if (size < PARALLEL_MIN_SIZE || reliq_get_allocator())
+    return 1;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus < 1)
+    cpus = 1;
+  size_t threads = size/PARALLEL_CHUNK_MIN;
+  if (threads > (size_t)cpus)
+    threads = cpus;
+  if (threads > PARALLEL_MAX_THREADS)
+    threads = PARALLEL_MAX_THREADS;
+  return threads;
+}
+
+static void
+html_parallel_handle(html_state *st, const size_t threads)
+{
+  const char *data = st->f;
+  const size_t size = st->s;
+  struct html_chunk *chunks = mem_alloc(threads*sizeof(struct html_chunk));
+  size_t chunksl = 0;
+
+  //the first chunk is parsed by the calling thread
+  for (size_t i = 1; i < threads; i++) {
+    const size_t prev = chunksl ? chunks[chunksl-1].start : 0;
+    size_t start = (size/threads)*i;
+    if (start <= prev)
+      start = prev+1;
+    start = chunk_start(data,start,size);
+    if (start >= size)
       break;
+    chunks[chunksl++].start = start;
+  }
+  for (size_t i = 0; i < chunksl; i++) {
+    struct html_chunk *c = chunks+i;
+    html_chunk_init(c,data,size,st->skip);
+    c->limit = (i+1 < chunksl) ? chunks[i+1].start : size;
+    c->started = (pthread_create(&c->thread,NULL,html_chunk_run,c) == 0);
+  }
+
+  size_t pos = html_range_handle(st,0,chunksl ? chunks[0].start : size);
+
+  for (size_t i = 0; i < chunksl; i++) {
+    struct html_chunk *c = chunks+i;
+    if (c->started)
+      pthread_join(c->thread,NULL);
+
+    if (!st->err) {
+      if (c->started && !c->st.err && c->start == pos) {
+        html_chunk_add(st,c);
+        pos = c->end;
+      } else
+        pos = html_range_handle(st,pos,c->limit);
+    }
+    html_chunk_free(c);
   }
+  mem_free(chunks);
+}
+#endif
+
+void
+html_buffers_init(struct html_buffers *b)
+{
+  b->nodes = flexarr_init(sizeof(reliq_chnode),NODES_INC);
+  b->attribs = flexarr_init(sizeof(reliq_cattrib),ATTRIB_INC);
+  b->frames = flexarr_init(sizeof(struct html_frame),FRAMES_INC);
+  b->atoms = flexarr_init(sizeof(struct html_atom),ATOMS_INC);
+}
+
+void
+html_buffers_free(struct html_buffers *b)
+{
+  flexarr_free(&b->nodes);
+  flexarr_free(&b->attribs);
+  flexarr_free(&b->frames);
+  flexarr_free(&b->atoms);
+}
+
+reliq_error *
+html_handle_buffers(const char *data, const size_t size, const uint8_t skip, struct html_buffers *b, reliq_index **index)
+{
+  b->nodes.size = 0;
+  b->attribs.size = 0;
+  b->frames.size = 0;
+  b->atoms.size = 0;
+
+  #ifndef RELIQ_HTML_HUGE
+  if (unlikely(size > RELIQ_DATA_MAX)) {
+    *index = NULL;
+    return reliq_set_error(RELIQ_ERROR_HTML,"html: document of size %lu exceeds %lu, reliq has to be compiled with O_HTML_HUGE",size,(size_t)RELIQ_DATA_MAX);
+  }
+  #endif
+
+  html_state st = {
+    .f = data,
+    .s = size,
+    .skip = skip,
+    .nodes = &b->nodes,
+    .attribs = &b->attribs,
+    .frames = &b->frames,
+    .atoms = &b->atoms,
+    .tagnames = index_names_init()
+  };
+  html_buffers_reserve(&st,0,size);
+
+  #ifdef RELIQ_THREADS
+  const size_t threads = parallel_threads(size);
+  if (threads > 1) {
+    html_parallel_handle(&st,threads);
+  } else
+  #endif
+    html_range_handle(&st,0,size);
 
   if (st.err) {
-    flexarr_free(&nodes_buffer);
-    flexarr_free(&attribs_buffer);
+    index_names_free(&st.tagnames);
+    b->nodes.size = 0;
+    b->attribs.size = 0;
+    *index = NULL;
+  } else
+    *index = atoms_finish(&b->atoms,b->nodes.size,&st.tagnames);
+  return st.err;
+}
+
+reliq_error *
+html_handle(const char *data, const size_t size, const uint8_t skip, reliq_chnode **nodes, size_t *nodesl, reliq_cattrib **attribs, size_t *attribsl, reliq_index **index)
+{
+  struct html_buffers b;
+  html_buffers_init(&b);
+  reliq_error *err = html_handle_buffers(data,size,skip,&b,index);
+  flexarr_free(&b.frames);
+  flexarr_free(&b.atoms);
+
+  if (err) {
+    flexarr_free(&b.nodes);
+    flexarr_free(&b.attribs);
 
     *nodes = NULL;
     *nodesl = 0;
     *attribs = NULL;
     *attribsl = 0;
   } else {
-    flexarr_conv(&nodes_buffer,(void**)nodes,nodesl);
-    flexarr_conv(&attribs_buffer,(void**)attribs,attribsl);
+    flexarr_conv(&b.nodes,(void**)nodes,nodesl);
+    flexarr_conv(&b.attribs,(void**)attribs,attribsl);
   }
-  return st.err;
+  return err;
 }
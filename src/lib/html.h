@@ -21,7 +21,33 @@
 
 #include "types.h"
 
-reliq_error *html_handle(const char *data, const size_t size, reliq_chnode **nodes, size_t *nodesl, reliq_cattrib **attribs, size_t *attribsl);
+#define TAGF_SELFCLOSING 0x1 //tags that don't end with </tag>
+#define TAGF_SCRIPT 0x2 //tags which insides should be ommited
+#define TAGF_AUTOCLOSING 0x4 //tags that don't need to be closed
+#define TAGF_INESCAPABLE 0x8 /* tags from which no closing tag can escape
+   e.g. <div><table></div></table></div> is valid because of it. */
+
+uint8_t html_tag_flags(const uint8_t tag); //returns TAGF_ of tag from tags.h
+bool html_tag_autocloses(const uint8_t tag, const uint8_t next); //returns 1 if opening of next closes tag
+
+//buffers of html_handle_buffers() which space can be reused between documents
+struct html_buffers {
+  flexarr nodes; //reliq_chnode
+  flexarr attribs; //reliq_cattrib
+  flexarr frames; //struct html_frame from html.c
+  flexarr atoms; //struct html_atom from html.c
+};
+
+void html_buffers_init(struct html_buffers *b);
+void html_buffers_free(struct html_buffers *b);
+
+/*
+  leaves nodes and attribs of document in b, previous contents of b are discarded,
+  nodes of kinds in skip (RELIQ_SKIP_) aren't added
+*/
+reliq_error *html_handle_buffers(const char *data, const size_t size, const uint8_t skip, struct html_buffers *b, reliq_index **index);
+
+reliq_error *html_handle(const char *data, const size_t size, const uint8_t skip, reliq_chnode **nodes, size_t *nodesl, reliq_cattrib **attribs, size_t *attribsl, reliq_index **index);
 
 #endif
 
@@ -0,0 +1,565 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "../ext.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "ctype.h"
+#include "utils.h"
+#include "tags.h"
+#include "index.h"
+
+#define NAMES_BUCKETS_MIN 64
+
+uint32_t
+index_name_hash(const char *name, const size_t namel)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < namel; i++) {
+    hash ^= (uint8_t)tolower_inline(name[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint32_t
+index_token_hash(const uint8_t kind, const char *name, const size_t namel)
+{
+  uint32_t hash = 2166136261u^kind;
+  for (size_t i = 0; i < namel; i++) {
+    hash ^= (uint8_t)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void
+index_names_grow(struct index_names *t)
+{
+  const uint32_t size = t->bucketsl ? t->bucketsl<<1 : NAMES_BUCKETS_MIN;
+  const uint32_t mask = size-1;
+  uint32_t *buckets = mem_calloc(size,sizeof(uint32_t));
+
+  const struct index_name *names = (struct index_name*)t->names.v;
+  const size_t namesl = t->names.size;
+  for (size_t i = 0; i < namesl; i++) {
+    uint32_t j = names[i].hash&mask;
+    while (buckets[j])
+      j = (j+1)&mask;
+    buckets[j] = i+1;
+  }
+
+  mem_free(t->buckets);
+  t->buckets = buckets;
+  t->bucketsl = size;
+}
+
+static uint32_t
+index_names_intern(struct index_names *t, const char *name, const size_t namel)
+{
+  if ((t->names.size+1)<<1 > t->bucketsl)
+    index_names_grow(t);
+
+  const uint32_t hash = index_name_hash(name,namel);
+  const uint32_t mask = t->bucketsl-1;
+  const struct index_name *names = (struct index_name*)t->names.v;
+
+  for (uint32_t j = hash&mask; ; j = (j+1)&mask) {
+    const uint32_t n = t->buckets[j];
+    if (!n) {
+      struct index_name *new = flexarr_inc(&t->names);
+      new->name = (reliq_cstr){ .b = name, .s = namel };
+      new->hash = hash;
+      t->buckets[j] = t->names.size;
+      return TAG_COUNT+t->names.size-1;
+    }
+
+    const struct index_name *x = names+n-1;
+    if (x->hash == hash && memcaseeq(x->name.b,name,x->name.s,namel))
+      return TAG_COUNT+n-1;
+  }
+}
+
+uint32_t
+index_names_atom(struct index_names *t, const char *name, const size_t namel)
+{
+  const uint8_t tag = tag_find(name,namel);
+  if (tag != TAG_OTHER)
+    return tag;
+  return index_names_intern(t,name,namel);
+}
+
+void
+index_names_free(struct index_names *t)
+{
+  mem_free(t->buckets);
+  t->buckets = NULL;
+  t->bucketsl = 0;
+  flexarr_free(&t->names);
+}
+
+reliq_index *
+index_create_from(uint32_t *atoms, const size_t nodesl, struct index_names *t)
+{
+  reliq_index *index = mem_calloc(1,sizeof(reliq_index));
+  index->atoms = atoms;
+  index->nodesl = nodesl;
+  index->buckets = t->buckets;
+  index->bucketsl = t->bucketsl;
+  t->buckets = NULL;
+  t->bucketsl = 0;
+  flexarr_conv(&t->names,(void**)&index->names,&index->namesl);
+  return index;
+}
+
+reliq_index *
+index_create(const reliq *rq)
+{
+  const size_t nodesl = rq->nodesl;
+  const reliq_chnode *nodes = rq->nodes;
+  struct index_names t = index_names_init();
+  uint32_t *atoms = mem_alloc(nodesl*sizeof(uint32_t));
+
+  for (size_t i = 0; i < nodesl; i++) {
+    const reliq_chnode *n = nodes+i;
+    atoms[i] = n->tag ? index_names_atom(&t,rq->data+n->all+n->tag,n->tagl) : TAG_OTHER;
+  }
+
+  return index_create_from(atoms,nodesl,&t);
+}
+
+static void
+index_tag_table_free(struct index_tag_table *t)
+{
+  if (!t)
+    return;
+  mem_free(t->nodes);
+  mem_free(t->start);
+  mem_free(t);
+}
+
+static void
+index_columns_free(struct index_columns *c)
+{
+  if (!c)
+    return;
+  mem_free(c->lvl);
+  mem_free(c->desc);
+  mem_free(c);
+}
+
+static void
+index_token_table_free(struct index_token_table *t)
+{
+  if (!t)
+    return;
+  mem_free(t->tokens);
+  mem_free(t->buckets);
+  mem_free(t->nodes);
+  mem_free(t->start);
+  mem_free(t);
+}
+
+void
+index_free(reliq_index *index)
+{
+  if (!index)
+    return;
+  mem_free(index->atoms);
+  mem_free(index->names);
+  mem_free(index->buckets);
+  index_tag_table_free(atomic_load(&index->tag_nodes));
+  mem_free(atomic_load(&index->parents));
+  index_columns_free(atomic_load(&index->columns));
+  index_token_table_free(atomic_load(&index->tokens));
+  mem_free(index);
+}
+
+uint32_t
+index_atom_find(const reliq_index *index, const uint8_t tag, const uint32_t hash, const char *name, const size_t namel)
+{
+  if (tag != TAG_OTHER)
+    return tag;
+  if (!index->bucketsl)
+    return -1;
+
+  const uint32_t mask = index->bucketsl-1;
+  for (uint32_t j = hash&mask; index->buckets[j]; j = (j+1)&mask) {
+    const uint32_t n = index->buckets[j];
+    const struct index_name *x = index->names+n-1;
+    if (x->hash == hash && memcaseeq(x->name.b,name,x->name.s,namel))
+      return TAG_COUNT+n-1;
+  }
+  return -1;
+}
+
+/*
+  Tables created on first use are freed by reliq_free() with allocator of
+  reliq, so they're allocated with it instead of the one set by thread
+  executing expression. Returns allocator that has to be restored.
+*/
+static const reliq_allocator *
+index_allocator_set(const reliq *rq)
+{
+  const reliq_allocator *prev = reliq_get_allocator();
+  reliq_set_allocator(rq->allocator);
+  return prev;
+}
+
+static struct index_tag_table *
+index_tag_table_create(const reliq_index *index)
+{
+  const size_t atomsl = TAG_COUNT+index->namesl;
+  const size_t nodesl = index->nodesl;
+  const uint32_t *atoms = index->atoms;
+  uint32_t *start = mem_calloc(atomsl+1,sizeof(uint32_t));
+
+  for (size_t i = 0; i < nodesl; i++)
+    if (atoms[i] != TAG_OTHER)
+      start[atoms[i]+1]++;
+  for (size_t i = 1; i <= atomsl; i++)
+    start[i] += start[i-1];
+
+  uint32_t *nodes = mem_alloc((start[atomsl]+1)*sizeof(uint32_t));
+  for (size_t i = 0; i < nodesl; i++)
+    if (atoms[i] != TAG_OTHER)
+      nodes[start[atoms[i]]++] = i;
+
+  //every start was moved to the start of the next group
+  for (size_t i = atomsl; i > 0; i--)
+    start[i] = start[i-1];
+  start[0] = 0;
+
+  struct index_tag_table *t = mem_alloc(sizeof(struct index_tag_table));
+  t->nodes = nodes;
+  t->start = start;
+  return t;
+}
+
+const uint32_t *
+index_tag_nodes(const reliq *rq, const uint32_t atom, size_t *count)
+{
+  reliq_index *index = rq->index;
+  struct index_tag_table *t = atomic_load_explicit(&index->tag_nodes,memory_order_acquire);
+  if (!t) {
+    const reliq_allocator *prev = index_allocator_set(rq);
+    struct index_tag_table *new = index_tag_table_create(index);
+    //if other thread was first t is set to its table
+    if (atomic_compare_exchange_strong(&index->tag_nodes,&t,new)) {
+      t = new;
+    } else
+      index_tag_table_free(new);
+    reliq_set_allocator(prev);
+  }
+
+  const uint32_t *start = t->start;
+  *count = start[atom+1]-start[atom];
+  return t->nodes+start[atom];
+}
+
+/*
+  Nodes are in document order so the parent of node is the closest preceding
+  node with lower level, if it's exactly one level lower. Stack holds nodes
+  that can still be parents i.e. ancestors of the last node.
+*/
+static uint32_t *
+index_parents_create(const reliq *rq)
+{
+  const size_t nodesl = rq->nodesl;
+  const reliq_chnode *nodes = rq->nodes;
+  uint32_t *parents = mem_alloc((nodesl+1)*sizeof(uint32_t));
+  flexarr stack = flexarr_init(sizeof(uint32_t),-(1<<8));
+
+  for (size_t i = 0; i < nodesl; i++) {
+    const uint16_t lvl = nodes[i].lvl;
+    uint32_t *v = (uint32_t*)stack.v;
+    while (stack.size && nodes[v[stack.size-1]].lvl >= lvl)
+      stack.size--;
+
+    uint32_t p = (uint32_t)-1;
+    if (stack.size && nodes[v[stack.size-1]].lvl == lvl-1)
+      p = v[stack.size-1];
+    parents[i] = p;
+
+    *(uint32_t*)flexarr_inc(&stack) = i;
+  }
+
+  flexarr_free(&stack);
+  return parents;
+}
+
+const uint32_t *
+index_parents(const reliq *rq)
+{
+  reliq_index *index = rq->index;
+  uint32_t *parents = atomic_load_explicit(&index->parents,memory_order_acquire);
+  if (!parents) {
+    const reliq_allocator *prev = index_allocator_set(rq);
+    uint32_t *new = index_parents_create(rq);
+    if (atomic_compare_exchange_strong(&index->parents,&parents,new)) {
+      parents = new;
+    } else
+      mem_free(new);
+    reliq_set_allocator(prev);
+  }
+  return parents;
+}
+
+static struct index_columns *
+index_columns_create(const reliq *rq)
+{
+  const size_t nodesl = rq->nodesl;
+  const reliq_chnode *nodes = rq->nodes;
+  uint16_t *lvl = mem_alloc((nodesl+1)*sizeof(uint16_t));
+  uint32_t *desc = mem_alloc((nodesl+1)*sizeof(uint32_t));
+
+  for (size_t i = 0; i < nodesl; i++) {
+    const reliq_chnode *n = nodes+i;
+    lvl[i] = n->lvl;
+    desc[i] = n->tag_count+n->text_count+n->comment_count;
+  }
+
+  struct index_columns *c = mem_alloc(sizeof(struct index_columns));
+  c->lvl = lvl;
+  c->desc = desc;
+  return c;
+}
+
+void
+index_columns(const reliq *rq, const uint16_t **lvl, const uint32_t **desc)
+{
+  reliq_index *index = rq->index;
+  struct index_columns *c = atomic_load_explicit(&index->columns,memory_order_acquire);
+  if (!c) {
+    const reliq_allocator *prev = index_allocator_set(rq);
+    struct index_columns *new = index_columns_create(rq);
+    if (atomic_compare_exchange_strong(&index->columns,&c,new)) {
+      c = new;
+    } else
+      index_columns_free(new);
+    reliq_set_allocator(prev);
+  }
+  *lvl = c->lvl;
+  *desc = c->desc;
+}
+
+size_t
+index_nodes_lower_bound(const uint32_t *nodes, const size_t nodesl, const uint32_t pos)
+{
+  size_t low = 0,high = nodesl;
+  while (low < high) {
+    const size_t mid = low+((high-low)>>1);
+    if (nodes[mid] < pos) {
+      low = mid+1;
+    } else
+      high = mid;
+  }
+  return low;
+}
+
+struct index_tokens {
+  flexarr tokens; //struct index_token
+  flexarr last; //uint32_t, position+1 of the last node that got token
+  flexarr nodes; //struct index_token_node
+  uint32_t *buckets; //index+1 of token in .tokens
+  uint32_t bucketsl; //power of 2
+};
+
+struct index_token_node {
+  uint32_t token;
+  uint32_t node;
+};
+
+static void
+index_tokens_grow(struct index_tokens *t)
+{
+  const uint32_t size = t->bucketsl ? t->bucketsl<<1 : NAMES_BUCKETS_MIN;
+  const uint32_t mask = size-1;
+  uint32_t *buckets = mem_calloc(size,sizeof(uint32_t));
+
+  const struct index_token *tokens = (struct index_token*)t->tokens.v;
+  const size_t tokensl = t->tokens.size;
+  for (size_t i = 0; i < tokensl; i++) {
+    uint32_t j = tokens[i].hash&mask;
+    while (buckets[j])
+      j = (j+1)&mask;
+    buckets[j] = i+1;
+  }
+
+  mem_free(t->buckets);
+  t->buckets = buckets;
+  t->bucketsl = size;
+}
+
+static void
+index_tokens_add(struct index_tokens *t, const uint8_t kind, const char *name, const size_t namel, const uint32_t node)
+{
+  if ((t->tokens.size+1)<<1 > t->bucketsl)
+    index_tokens_grow(t);
+
+  const uint32_t hash = index_token_hash(kind,name,namel);
+  const uint32_t mask = t->bucketsl-1;
+  const struct index_token *tokens = (struct index_token*)t->tokens.v;
+  uint32_t *last = (uint32_t*)t->last.v;
+  uint32_t token;
+
+  for (uint32_t j = hash&mask; ; j = (j+1)&mask) {
+    const uint32_t n = t->buckets[j];
+    if (!n) {
+      struct index_token *new = flexarr_inc(&t->tokens);
+      new->name = (reliq_cstr){ .b = name, .s = namel };
+      new->hash = hash;
+      new->kind = kind;
+      *(uint32_t*)flexarr_incz(&t->last) = 0;
+      last = (uint32_t*)t->last.v;
+      t->buckets[j] = t->tokens.size;
+      token = t->tokens.size-1;
+      break;
+    }
+
+    const struct index_token *x = tokens+n-1;
+    if (x->hash == hash && x->kind == kind && x->name.s == namel
+      && memcmp(x->name.b,name,namel) == 0) {
+      token = n-1;
+      break;
+    }
+  }
+
+  //the same word can repeat in attribute
+  if (last[token] == node+1)
+    return;
+  last[token] = node+1;
+
+  struct index_token_node *new = flexarr_inc(&t->nodes);
+  new->token = token;
+  new->node = node;
+}
+
+static void
+index_tokens_add_words(struct index_tokens *t, const uint8_t kind, const char *value, const size_t valuel, const uint32_t node)
+{
+  const char *ptr = value;
+  char const *saveptr,*word;
+  size_t saveptrlen,wordlen;
+
+  while (1) {
+    memwordtok_r(ptr,valuel,&saveptr,&saveptrlen,&word,&wordlen);
+    if (!word)
+      return;
+    index_tokens_add(t,kind,word,wordlen,node);
+    ptr = NULL;
+  }
+}
+
+static struct index_token_table *
+index_tokens_create(const reliq *rq)
+{
+  const size_t nodesl = rq->nodesl;
+  const reliq_chnode *nodes = rq->nodes;
+  struct index_tokens t = {
+    .tokens = flexarr_init(sizeof(struct index_token),-(1<<6)),
+    .last = flexarr_init(sizeof(uint32_t),-(1<<6)),
+    .nodes = flexarr_init(sizeof(struct index_token_node),-(1<<10))
+  };
+
+  for (size_t i = 0; i < nodesl; i++) {
+    const reliq_chnode *n = nodes+i;
+    if (!n->tag)
+      continue;
+
+    const reliq_cattrib *a = rq->attribs+n->attribs;
+    const uint32_t attribsl = reliq_chnode_attribsl(rq,n);
+    for (uint32_t j = 0; j < attribsl; j++) {
+      const char *key = rq->data+a[j].key;
+      uint8_t kind;
+      if (memcaseeq(key,"class",a[j].keyl,5)) {
+        kind = INDEX_TOKEN_CLASS;
+      } else if (memcaseeq(key,"id",a[j].keyl,2)) {
+        kind = INDEX_TOKEN_ID;
+      } else
+        continue;
+
+      index_tokens_add_words(&t,kind,key+a[j].keyl+a[j].value,a[j].valuel,i);
+    }
+  }
+
+  const size_t tokensl = t.tokens.size;
+  const struct index_token_node *tnodes = (struct index_token_node*)t.nodes.v;
+  const size_t tnodesl = t.nodes.size;
+  uint32_t *start = mem_calloc(tokensl+2,sizeof(uint32_t));
+
+  //nodes were added in order so every group stays sorted
+  for (size_t i = 0; i < tnodesl; i++)
+    start[tnodes[i].token+1]++;
+  for (size_t i = 1; i <= tokensl; i++)
+    start[i] += start[i-1];
+
+  uint32_t *tokennodes = mem_alloc((tnodesl+1)*sizeof(uint32_t));
+  for (size_t i = 0; i < tnodesl; i++)
+    tokennodes[start[tnodes[i].token]++] = tnodes[i].node;
+
+  for (size_t i = tokensl; i > 0; i--)
+    start[i] = start[i-1];
+  start[0] = 0;
+
+  flexarr_free(&t.last);
+  flexarr_free(&t.nodes);
+  struct index_token_table *table = mem_alloc(sizeof(struct index_token_table));
+  flexarr_conv(&t.tokens,(void**)&table->tokens,&table->tokensl);
+  table->buckets = t.buckets;
+  table->bucketsl = t.bucketsl;
+  table->nodes = tokennodes;
+  table->start = start;
+  return table;
+}
+
+const uint32_t *
+index_token_nodes(const reliq *rq, const uint8_t kind, const uint32_t hash, const char *name, const size_t namel, size_t *count)
+{
+  reliq_index *index = rq->index;
+  struct index_token_table *t = atomic_load_explicit(&index->tokens,memory_order_acquire);
+  if (!t) {
+    const reliq_allocator *prev = index_allocator_set(rq);
+    struct index_token_table *new = index_tokens_create(rq);
+    if (atomic_compare_exchange_strong(&index->tokens,&t,new)) {
+      t = new;
+    } else
+      index_token_table_free(new);
+    reliq_set_allocator(prev);
+  }
+
+  *count = 0;
+  if (!t->bucketsl)
+    return NULL;
+
+  const uint32_t mask = t->bucketsl-1;
+  for (uint32_t j = hash&mask; t->buckets[j]; j = (j+1)&mask) {
+    const uint32_t n = t->buckets[j];
+    const struct index_token *x = t->tokens+n-1;
+    if (x->hash == hash && x->kind == kind && x->name.s == namel
+      && memcmp(x->name.b,name,namel) == 0) {
+      const uint32_t *start = t->start;
+      *count = start[n]-start[n-1];
+      return t->nodes+start[n-1];
+    }
+  }
+  return NULL;
+}
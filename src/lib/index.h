@@ -0,0 +1,155 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef RELIQ_INDEX_H
+#define RELIQ_INDEX_H
+
+#include <stdatomic.h>
+
+#include "types.h"
+#include "utils.h"
+#include "tags.h"
+
+/*
+    Lookup tables of a single document, they're created by reliq_init()
+    and freed by reliq_free().
+
+    Every node gets an atom identifying its tag name without case distinction.
+    Names known to html parser use their TAG_ ids from tags.h, other names are
+    interned in .names and get ids starting at TAG_COUNT. Nodes that aren't
+    tags get TAG_OTHER.
+
+    Words of class attributes and id attributes are interned as tokens
+    distinguished by their kind and compared with case distinction, the same
+    way .class and #id shortcuts match them.
+
+    Tables that are rarely needed are created on first use. Threads
+    executing the same reliq at once can both create a table, only the one
+    that sets it first is kept and the other is freed, so tables that are
+    set never change.
+*/
+
+//kinds of index_token
+#define INDEX_TOKEN_CLASS 0
+#define INDEX_TOKEN_ID 1
+
+struct index_name {
+  reliq_cstr name; //first occurrence in document
+  uint32_t hash;
+};
+
+struct index_token {
+  reliq_cstr name; //first occurrence in document
+  uint32_t hash; //index_token_hash()
+  uint8_t kind; //INDEX_TOKEN_
+};
+
+//created by index_tag_nodes()
+struct index_tag_table {
+  uint32_t *nodes; //positions of nodes grouped by atom, each group is sorted
+  uint32_t *start; //start of group of atom in .nodes, has an additional element at the end
+};
+
+/*
+  created by index_columns(), fields of reliq.nodes kept in separate arrays
+  so that walking over nodes by their levels doesn't load whole nodes
+*/
+struct index_columns {
+  uint16_t *lvl;
+  uint32_t *desc; //number of descendants
+};
+
+//created by index_token_nodes()
+struct index_token_table {
+  struct index_token *tokens;
+  uint32_t *buckets; //index+1 of token in .tokens
+  uint32_t *nodes; //positions of nodes grouped by token, each group is sorted
+  uint32_t *start; //same as index_tag_table.start
+  size_t tokensl;
+  uint32_t bucketsl; //power of 2
+};
+
+struct reliq_index {
+  uint32_t *atoms; //atom of each node, parallel to reliq.nodes
+  struct index_name *names; //atoms starting at TAG_COUNT
+  uint32_t *buckets; //index+1 of name in .names
+  size_t nodesl;
+  size_t namesl;
+  uint32_t bucketsl; //power of 2
+
+  //tables created on first use, NULL until then
+  _Atomic(struct index_tag_table*) tag_nodes;
+  _Atomic(uint32_t*) parents; //created by index_parents()
+  _Atomic(struct index_columns*) columns;
+  _Atomic(struct index_token_table*) tokens;
+};
+
+//table used for interning names while atoms are assigned
+struct index_names {
+  flexarr names; //struct index_name
+  uint32_t *buckets; //index+1 of name in .names
+  uint32_t bucketsl; //power of 2
+};
+
+#define index_names_init() (struct index_names){ .names = flexarr_init(sizeof(struct index_name),-(1<<6)) }
+uint32_t index_names_atom(struct index_names *t, const char *name, const size_t namel);
+void index_names_free(struct index_names *t);
+
+uint32_t index_name_hash(const char *name, const size_t namel);
+uint32_t index_token_hash(const uint8_t kind, const char *name, const size_t namel);
+
+//takes ownership of atoms and names
+reliq_index *index_create_from(uint32_t *atoms, const size_t nodesl, struct index_names *t);
+//creates index from tag names of already parsed document
+reliq_index *index_create(const reliq *rq);
+void index_free(reliq_index *index);
+
+//returns atom of name or -1 if document doesn't have it, tag and hash are the same as in index_atom_eq()
+uint32_t index_atom_find(const reliq_index *index, const uint8_t tag, const uint32_t hash, const char *name, const size_t namel);
+
+//returns sorted positions of nodes with atom
+const uint32_t *index_tag_nodes(const reliq *rq, const uint32_t atom, size_t *count);
+
+/*
+    returns sorted positions of nodes having token in class or id attribute
+    (depending on kind), hash has to be computed by index_token_hash(). rq has
+    to have index.
+*/
+const uint32_t *index_token_nodes(const reliq *rq, const uint8_t kind, const uint32_t hash, const char *name, const size_t namel, size_t *count);
+
+//returns positions of parents of every node, nodes without parent have (uint32_t)-1
+const uint32_t *index_parents(const reliq *rq);
+
+void index_columns(const reliq *rq, const uint16_t **lvl, const uint32_t **desc);
+
+//returns position of the first element of sorted nodes that is not lower than pos
+size_t index_nodes_lower_bound(const uint32_t *nodes, const size_t nodesl, const uint32_t pos);
+
+//tag and hash have to be computed from name by tag_find() and index_name_hash()
+static inline bool
+index_atom_eq(const reliq_index *index, const uint32_t atom, const uint8_t tag, const uint32_t hash, const char *name, const size_t namel)
+{
+  if (tag != TAG_OTHER)
+    return (atom == tag);
+  if (atom < TAG_COUNT)
+    return 0;
+  const struct index_name *n = index->names+(atom-TAG_COUNT);
+  return (n->hash == hash && memcaseeq(n->name.b,name,n->name.s,namel));
+}
+
+#endif
@@ -21,9 +21,11 @@
 #include <assert.h>
 
 #include "reliq.h"
+#include "alloc.h"
 #include "output.h"
 #include "npattern_intr.h"
 #include "utils.h"
+#include "index.h"
 #include "node_exec.h"
 
 const struct axis_incompability {
@@ -48,6 +50,41 @@ const struct axis_replacement {
   {AXIS_EVERYTHING,AXIS_SELF|AXIS_BEFORE|AXIS_AFTER},
 };
 
+/*
+  Levels and numbers of descendants of nodes, read from columns of
+  reliq_index when document has it so that skipping over nodes doesn't
+  load them whole.
+*/
+typedef struct {
+  const reliq_chnode *nodes;
+  const uint16_t *lvl;
+  const uint32_t *desc;
+} node_columns;
+
+static inline node_columns
+columns_get(const reliq *rq)
+{
+  node_columns c = { .nodes = rq->nodes };
+  if (rq->index)
+    index_columns(rq,&c.lvl,&c.desc);
+  return c;
+}
+
+static inline uint16_t
+column_lvl(const node_columns *c, const size_t i)
+{
+  return c->lvl ? c->lvl[i] : c->nodes[i].lvl;
+}
+
+static inline uint32_t
+column_desc(const node_columns *c, const size_t i)
+{
+  if (c->desc)
+    return c->desc[i];
+  const reliq_chnode *n = c->nodes+i;
+  return n->tag_count+n->text_count+n->comment_count;
+}
+
 static inline void
 add_compressed(flexarr *dest, const uint32_t hnode, const uint32_t parent) //dest: reliq_compressed
 {
@@ -57,39 +94,93 @@ add_compressed(flexarr *dest, const uint32_t hnode, const uint32_t parent) //des
 }
 
 static inline void
-match_add(const reliq *rq, reliq_chnode const *hnode, reliq_chnode const *parent, reliq_npattern const *nodep, flexarr *dest, uint32_t *found) //dest: reliq_compressed
+match_add(const reliq *rq, reliq_nmemo *memo, reliq_chnode const *hnode, reliq_chnode const *parent, reliq_npattern const *nodep, flexarr *dest, uint32_t *found) //dest: reliq_compressed
 {
-  if (!reliq_nexec(rq,hnode,parent,nodep))
+  if (!reliq_nexec(rq,memo,hnode,parent,nodep))
     return;
   add_compressed(dest,hnode-rq->nodes,
     parent ? parent-rq->nodes : (uint32_t)-1);
   (*found)++;
 }
 
+/*
+  Gets sorted positions of the only nodes that can be matched by nodep
+  if it requires a tag name or a class or id word, the shorter of them
+  is chosen. Returns 0 if every node has to be checked.
+*/
+static bool
+candidates(const reliq *rq, const reliq_npattern *nodep, const uint32_t **cand, size_t *candl)
+{
+  const struct ptag *tag = nodep->tag;
+  const struct ptoken *token = nodep->token;
+  if ((!tag && !token) || !rq->index)
+    return 0;
+
+  *cand = NULL;
+  *candl = 0;
+  if (tag) {
+    const uint32_t atom = index_atom_find(rq->index,tag->tag,tag->hash,tag->name.b,tag->name.s);
+    if (atom == (uint32_t)-1)
+      return 1;
+    *cand = index_tag_nodes(rq,atom,candl);
+  }
+
+  if (token) {
+    size_t tokenl;
+    const uint32_t *tokencand = index_token_nodes(rq,token->kind,token->hash,token->name.b,token->name.s,&tokenl);
+    if (!tag || tokenl < *candl) {
+      *cand = tokencand;
+      *candl = tokenl;
+    }
+  }
+  return 1;
+}
+
+//matches candidates in range [start,end)
+static void
+candidates_match(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *nodep, const uint32_t *cand, const size_t candl, const uint32_t start, const uint32_t end, const reliq_chnode *parent, flexarr *dest, uint32_t *found, const uint32_t lasttofind) //dest: reliq_compressed
+{
+  for (size_t i = index_nodes_lower_bound(cand,candl,start); i < candl && cand[i] < end; i++) {
+    match_add(rq,memo,rq->nodes+cand[i],parent,nodep,dest,found);
+    if (*found >= lasttofind)
+      return;
+  }
+}
+
 #define XN(x) match_##x
-#define X(x) static void XN(x)(const UNUSED reliq *rq, const UNUSED reliq_npattern *nodep, const UNUSED reliq_chnode *current, const UNUSED reliq_chnode *parent, flexarr *dest, uint32_t UNUSED *found, const uint32_t UNUSED lasttofind)
+#define X(x) static void XN(x)(const UNUSED reliq *rq, reliq_nmemo UNUSED *memo, const UNUSED reliq_npattern *nodep, const UNUSED reliq_chnode *current, const UNUSED reliq_chnode *parent, flexarr *dest, uint32_t UNUSED *found, const uint32_t UNUSED lasttofind)
 
 X(descendants) {
   const uint32_t desccount = current->tag_count+current->text_count+current->comment_count;
+  const uint32_t *cand;
+  size_t candl;
+  if (candidates(rq,nodep,&cand,&candl)) {
+    const uint32_t start = current-rq->nodes+1;
+    candidates_match(rq,memo,nodep,cand,candl,start,start+desccount,current,dest,found,lasttofind);
+    return;
+  }
+
   for (size_t i = 1; i <= desccount; i++) {
-    match_add(rq,current+i,current,nodep,dest,found);
+    match_add(rq,memo,current+i,current,nodep,dest,found);
     if (*found >= lasttofind)
       return;
   }
 }
 
 X(only_self) {
-  match_add(rq,current,parent,nodep,dest,found);
+  match_add(rq,memo,current,parent,nodep,dest,found);
 }
 
 X(self) {
-  match_add(rq,current,current,nodep,dest,found);
+  match_add(rq,memo,current,current,nodep,dest,found);
 }
 
 X(children) {
-  const uint32_t desccount = current->tag_count+current->text_count+current->comment_count;
-  for (size_t i = 1; i <= desccount; i += current[i].tag_count+current[i].text_count+current[i].comment_count+1) {
-    match_add(rq,current+i,current,nodep,dest,found);
+  const node_columns c = columns_get(rq);
+  const size_t pos = current-rq->nodes;
+  const uint32_t desccount = column_desc(&c,pos);
+  for (size_t i = 1; i <= desccount; i += column_desc(&c,pos+i)+1) {
+    match_add(rq,memo,current+i,current,nodep,dest,found);
     if (*found >= lasttofind)
       return;
   }
@@ -97,12 +188,21 @@ X(children) {
 
 X(relative_parent) {
   if (parent)
-    match_add(rq,parent,current,nodep,dest,found);
+    match_add(rq,memo,parent,current,nodep,dest,found);
 }
 
 static inline const reliq_chnode *
-find_parent(const reliq_chnode *nodes, const reliq_chnode *current)
+find_parent(const reliq *rq, const reliq_chnode *current)
 {
+  const reliq_chnode *nodes = rq->nodes;
+  if (rq->index) {
+    const uint32_t p = index_parents(rq)[current-nodes];
+    return (p == (uint32_t)-1) ? NULL : nodes+p;
+  }
+
+  if (current == nodes)
+    return NULL;
+
   uint16_t lvl = current->lvl-1;
   for (size_t j=(current-nodes)-1; nodes[j].lvl >= lvl; j--) {
     if (nodes[j].lvl == lvl)
@@ -116,39 +216,39 @@ find_parent(const reliq_chnode *nodes, const reliq_chnode *current)
 }
 
 X(ancestors) {
-  const reliq_chnode *nodes=rq->nodes;
   const reliq_chnode *first=current;
 
-  while (current != nodes) {
-    current = find_parent(nodes,current);
+  while (1) {
+    current = find_parent(rq,current);
     if (!current)
       break;
 
-    match_add(rq,current,first,nodep,dest,found);
+    match_add(rq,memo,current,first,nodep,dest,found);
     if (*found >= lasttofind)
       return;
   }
 }
 
 X(parent) {
-  const reliq_chnode *p = find_parent(rq->nodes,current);
+  const reliq_chnode *p = find_parent(rq,current);
   if (!p)
     return;
 
-  match_add(rq,p,current,nodep,dest,found);
+  match_add(rq,memo,p,current,nodep,dest,found);
 }
 
 static inline void
-siblings_preceding(const reliq *rq, const reliq_npattern *nodep, const reliq_chnode *current, flexarr *dest, uint32_t *found, const uint32_t lasttofind, const bool full)
+siblings_preceding(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *nodep, const reliq_chnode *current, flexarr *dest, uint32_t *found, const uint32_t lasttofind, const bool full)
 {
   const reliq_chnode *nodes = rq->nodes;
   if (nodes == current)
     return;
+  const node_columns c = columns_get(rq);
   const uint16_t lvl = current->lvl;
 
-  for (size_t i=(current-nodes)-1; nodes[i].lvl >= lvl; i--) {
-    if (full || nodes[i].lvl == lvl) {
-      match_add(rq,nodes+i,current,nodep,dest,found);
+  for (size_t i=(current-nodes)-1; column_lvl(&c,i) >= lvl; i--) {
+    if (full || column_lvl(&c,i) == lvl) {
+      match_add(rq,memo,nodes+i,current,nodep,dest,found);
       if (*found >= lasttofind)
         return;
     }
@@ -158,25 +258,26 @@ siblings_preceding(const reliq *rq, const reliq_npattern *nodep, const reliq_chn
 }
 
 X(siblings_preceding) {
-  siblings_preceding(rq,nodep,current,dest,found,lasttofind,0);
+  siblings_preceding(rq,memo,nodep,current,dest,found,lasttofind,0);
 }
 
 X(full_siblings_preceding) {
-  siblings_preceding(rq,nodep,current,dest,found,lasttofind,1);
+  siblings_preceding(rq,memo,nodep,current,dest,found,lasttofind,1);
 }
 
 X(siblings_subsequent) {
   reliq_chnode *nodes = rq->nodes;
   const size_t nodesl = rq->nodesl;
+  const node_columns c = columns_get(rq);
   const uint16_t lvl = current->lvl;
-  const size_t desc = current->tag_count+current->comment_count+current->text_count;
+  const size_t desc = column_desc(&c,current-nodes);
 
-  for (size_t i=(current-nodes)+desc+1; i < nodesl && nodes[i].lvl == lvl;) {
-    match_add(rq,nodes+i,current,nodep,dest,found);
+  for (size_t i=(current-nodes)+desc+1; i < nodesl && column_lvl(&c,i) == lvl;) {
+    match_add(rq,memo,nodes+i,current,nodep,dest,found);
     if (*found >= lasttofind)
       return;
 
-    i += nodes[i].tag_count+nodes[i].text_count+nodes[i].comment_count+1;
+    i += column_desc(&c,i)+1;
   }
 }
 
@@ -187,7 +288,7 @@ X(full_siblings_subsequent) {
   const size_t desc = current->tag_count+current->comment_count+current->text_count;
 
   for (size_t i=(current-nodes)+desc+1; i < nodesl && nodes[i].lvl >= lvl; i++) {
-    match_add(rq,nodes+i,current,nodep,dest,found);
+    match_add(rq,memo,nodes+i,current,nodep,dest,found);
     if (*found >= lasttofind)
       return;
   }
@@ -196,8 +297,15 @@ X(full_siblings_subsequent) {
 X(everything) {
   const size_t nodesl = rq->nodesl;
   const reliq_chnode *nodes = rq->nodes;
+  const uint32_t *cand;
+  size_t candl;
+  if (candidates(rq,nodep,&cand,&candl)) {
+    candidates_match(rq,memo,nodep,cand,candl,0,nodesl,current,dest,found,lasttofind);
+    return;
+  }
+
   for (size_t i = 0; i < nodesl && *found < lasttofind; i++)
-    match_add(rq,nodes+i,current,nodep,dest,found);
+    match_add(rq,memo,nodes+i,current,nodep,dest,found);
 }
 
 X(preceding) {
@@ -216,7 +324,7 @@ X(preceding) {
       continue;
     }
 
-    match_add(rq,nodes+i,current,nodep,dest,found);
+    match_add(rq,memo,nodes+i,current,nodep,dest,found);
     if (*found >= lasttofind || i == 0)
       return;
   }
@@ -228,7 +336,7 @@ X(before) {
     return;
 
   for (size_t i = current-nodes-1; ; i--) {
-    match_add(rq,nodes+i,current,nodep,dest,found);
+    match_add(rq,memo,nodes+i,current,nodep,dest,found);
     if (*found >= lasttofind || i == 0)
       return;
   }
@@ -241,7 +349,7 @@ X(subsequent)
   const size_t nodesl = rq->nodesl;
 
   for (size_t i = (current-nodes)+desc+1; i < nodesl; i++) {
-    match_add(rq,nodes+i,current,nodep,dest,found);
+    match_add(rq,memo,nodes+i,current,nodep,dest,found);
     if (*found >= lasttofind)
       return;
   }
@@ -253,7 +361,7 @@ X(after)
   const size_t nodesl = rq->nodesl;
 
   for (size_t i = (current-nodes)+1; i < nodesl; i++) {
-    match_add(rq,nodes+i,current,nodep,dest,found);
+    match_add(rq,memo,nodes+i,current,nodep,dest,found);
     if (*found >= lasttofind)
       return;
   }
@@ -314,14 +422,14 @@ axis_replace(uint16_t type)
   return type;
 }
 
-void
+bool
 axis_comp_functions(uint16_t type, axis_func_t *out)
 {
   type = axis_replace(type);
   if (type == AXIS_SELF) {
     out[0] = XN(only_self);
     out[1] = NULL;
-    return;
+    return 1;
   }
 
   size_t len = 0;
@@ -335,15 +443,16 @@ axis_comp_functions(uint16_t type, axis_func_t *out)
   }
   if (len != AXIS_FUNCS_MAX)
     out[len] = NULL;
+  return ((type&AXIS_RELATIVE_PARENT) != 0);
 }
 
 #undef XN
 
 static void
-axis_run(const reliq *rq, const reliq_npattern *nodep, const reliq_chnode *current, const reliq_chnode *parent, flexarr *dest, uint32_t *found, const uint32_t lasttofind)
+axis_run(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *nodep, const reliq_chnode *current, const reliq_chnode *parent, flexarr *dest, uint32_t *found, const uint32_t lasttofind)
 {
   for (size_t i = 0; i < AXIS_FUNCS_MAX && nodep->axis_funcs[i] != NULL && *found < lasttofind; i++)
-    ((axis_func_t)nodep->axis_funcs[i]) (rq,nodep,current,parent,dest,found,lasttofind);
+    ((axis_func_t)nodep->axis_funcs[i]) (rq,memo,nodep,current,parent,dest,found,lasttofind);
 }
 
 static void
@@ -367,19 +476,87 @@ dest_match_position(const reliq_range *range, flexarr *dest, size_t start, size_
 }
 
 static void
-node_exec_first(const reliq *rq, const reliq_npattern *nodep, flexarr *dest, const uint32_t lasttofind) //dest: reliq_compressed
+node_exec_first(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *nodep, flexarr *dest, const uint32_t lasttofind) //dest: reliq_compressed
 {
   const size_t nodesl = rq->nodesl;
   uint32_t found = 0;
-  for (size_t i = 0; i < nodesl && found < lasttofind; i++)
-    match_add(rq,rq->nodes+i,NULL,nodep,dest,&found);
+  const uint32_t *cand;
+  size_t candl;
+  if (candidates(rq,nodep,&cand,&candl)) {
+    candidates_match(rq,memo,nodep,cand,candl,0,nodesl,NULL,dest,&found,lasttofind);
+  } else {
+    for (size_t i = 0; i < nodesl && found < lasttofind; i++)
+      match_add(rq,memo,rq->nodes+i,NULL,nodep,dest,&found);
+  }
 
   if (nodep->position.s)
     dest_match_position(&nodep->position,dest,0,dest->size);
 }
 
 void
-node_exec(const reliq *rq, const reliq_npattern *nodep, const flexarr *source, flexarr *dest) //source: reliq_compressed, dest: reliq_compressed
+node_exec_first_multi(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *const *nodeps, const size_t nodepsl, flexarr *dests) //dests: reliq_compressed
+{
+  struct first_scan {
+    const reliq_npattern *nodep;
+    flexarr *dest;
+    uint32_t found;
+    uint32_t lasttofind;
+    uint8_t types; //reliq_ntypes()
+  };
+  if (!nodepsl)
+    return;
+  struct first_scan *scan = mem_alloc(nodepsl*sizeof(struct first_scan));
+  size_t scanl = 0;
+  uint8_t types = 0; //types of nodes matched by any of scan
+  const size_t nodesl = rq->nodesl;
+
+  for (size_t i = 0; i < nodepsl; i++) {
+    const reliq_npattern *nodep = nodeps[i];
+    uint32_t lasttofind = nodep->position_max;
+    if (lasttofind == (uint32_t)-1)
+      continue;
+    if (lasttofind == 0)
+      lasttofind = -1;
+
+    uint32_t found = 0;
+    const uint32_t *cand;
+    size_t candl;
+    if (candidates(rq,nodep,&cand,&candl)) {
+      candidates_match(rq,memo,nodep,cand,candl,0,nodesl,NULL,dests+i,&found,lasttofind);
+    } else {
+      const uint8_t t = reliq_ntypes(nodep);
+      scan[scanl++] = (struct first_scan){ .nodep = nodep, .dest = dests+i, .lasttofind = lasttofind, .types = t };
+      types |= t;
+    }
+  }
+
+  /*
+    patterns without candidates are checked together so that type of each
+    node is found once and nodes that none of them can match are skipped
+  */
+  for (size_t i = 0; i < nodesl && scanl; i++) {
+    const reliq_chnode *chnode = rq->nodes+i;
+    const uint8_t type = 1<<reliq_chnode_type(chnode);
+    if (!(types&type))
+      continue;
+    for (size_t j = 0; j < scanl; j++) {
+      struct first_scan *sc = scan+j;
+      if (!(sc->types&type))
+        continue;
+      match_add(rq,memo,chnode,NULL,sc->nodep,sc->dest,&sc->found);
+      if (sc->found >= sc->lasttofind)
+        scan[j--] = scan[--scanl];
+    }
+  }
+  mem_free(scan);
+
+  for (size_t i = 0; i < nodepsl; i++)
+    if (nodeps[i]->position.s)
+      dest_match_position(&nodeps[i]->position,dests+i,0,dests[i].size);
+}
+
+void
+node_exec(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *nodep, const flexarr *source, flexarr *dest) //source: reliq_compressed, dest: reliq_compressed
 {
   uint32_t found=0,lasttofind=nodep->position_max;
   if (lasttofind == (uint32_t)-1)
@@ -388,7 +565,7 @@ node_exec(const reliq *rq, const reliq_npattern *nodep, const flexarr *source, f
     lasttofind = -1;
 
   if (source->size == 0) {
-    node_exec_first(rq,nodep,dest,lasttofind);
+    node_exec_first(rq,memo,nodep,dest,lasttofind);
     return;
   }
 
@@ -402,7 +579,7 @@ node_exec(const reliq *rq, const reliq_npattern *nodep, const flexarr *source, f
     size_t prevdestsize = dest->size;
     const reliq_chnode *hn_parent = (x->parent == (uint32_t)-1) ? NULL : nodes+x->parent;
 
-    axis_run(rq,nodep,hn,hn_parent,dest,&found,lasttofind);
+    axis_run(rq,memo,nodep,hn,hn_parent,dest,&found,lasttofind);
 
     if (nodep->position.s) {
       if (!(nodep->flags&N_POSITION_ABSOLUTE)) {
@@ -415,3 +592,30 @@ node_exec(const reliq *rq, const reliq_npattern *nodep, const flexarr *source, f
   if (nodep->flags&N_POSITION_ABSOLUTE && nodep->position.s)
     dest_match_position(&nodep->position,dest,0,dest->size);
 }
+
+bool
+node_exec_any(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *nodep, const flexarr *source) //source: reliq_compressed
+{
+  flexarr dest = flexarr_init(sizeof(reliq_compressed),1);
+  if (nodep->position.s || !source->size) {
+    //position depends on all found nodes and empty source means the whole document
+    node_exec(rq,memo,nodep,source,&dest);
+    goto END;
+  }
+
+  const reliq_chnode *nodes = rq->nodes;
+  const size_t size = source->size;
+  for (size_t i = 0; i < size && !dest.size; i++) {
+    const reliq_compressed *x = &((reliq_compressed*)source->v)[i];
+    if (OUTFIELDCODE(x->hnode))
+      continue;
+    const reliq_chnode *hn_parent = (x->parent == (uint32_t)-1) ? NULL : nodes+x->parent;
+    uint32_t found = 0;
+    axis_run(rq,memo,nodep,nodes+x->hnode,hn_parent,&dest,&found,1);
+  }
+
+  END: ;
+  const bool ret = (dest.size != 0);
+  flexarr_free(&dest);
+  return ret;
+}
@@ -39,10 +39,19 @@
 #define AXIS_SUBSEQUENT (1<<13)
 #define AXIS_EVERYTHING (1<<14)
 
-typedef void (*axis_func_t)(const reliq*, const reliq_npattern*, const reliq_chnode*, const reliq_chnode*, flexarr*, uint32_t*, const uint32_t);
+typedef void (*axis_func_t)(const reliq*, reliq_nmemo*, const reliq_npattern*, const reliq_chnode*, const reliq_chnode*, flexarr*, uint32_t*, const uint32_t);
 
-void axis_comp_functions(uint16_t type, axis_func_t *out);
+//returns 1 if functions match nodes against parent of node they start from
+bool axis_comp_functions(uint16_t type, axis_func_t *out);
 
-void node_exec(const reliq *rq, const reliq_npattern *nodep, const flexarr *source, flexarr *dest); //source: reliq_compressed, dest: reliq_compressed
+void node_exec(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *nodep, const flexarr *source, flexarr *dest); //source: reliq_compressed, dest: reliq_compressed
+/*
+  Does the same as node_exec() with empty source for every element of nodeps,
+  writing its results to the element of dests at the same position.
+  Patterns that can't use the index are matched in a single pass over nodes.
+*/
+void node_exec_first_multi(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *const *nodeps, const size_t nodepsl, flexarr *dests); //dests: reliq_compressed
+//returns 1 if node_exec() would find anything, stops at the first found node
+bool node_exec_any(const reliq *rq, reliq_nmemo *memo, const reliq_npattern *nodep, const flexarr *source); //source: reliq_compressed
 
 #endif
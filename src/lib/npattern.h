@@ -23,6 +23,13 @@
 #include "range.h"
 
 typedef struct nmatchers_node nmatchers_node;
+struct ptag;
+struct ptoken;
+
+struct nmemo_hook {
+  const void *hook; //reliq_hook
+  uint64_t *bits; //bitset of evaluated nodes followed by bitset of results
+};
 
 typedef struct {
   nmatchers_node *list;
@@ -34,15 +41,32 @@ typedef struct {
 
 typedef struct {
   nmatchers matches;
+  struct ninstr *code; //matches compiled for reliq_nexec()
   reliq_range position;
   void (*axis_funcs[AXIS_FUNCS_MAX])(void); //gcc complains if its just a void*
+  const struct ptag *tag; //tag name that every matched node has, can be NULL
+  const struct ptoken *token; //class or id word that every matched node has, can be NULL
 
   uint32_t position_max;
   uint16_t flags; //N_
 } reliq_npattern;
 
+/*
+  Results of has@ hooks remembered for nodes of a single document, it's
+  created by the outermost execution of expression and passed down to
+  executions nested in it, so it's never shared between threads.
+*/
+typedef struct reliq_nmemo {
+  flexarr hooks; //struct nmemo_hook
+} reliq_nmemo;
+
+#define reliq_nmemo_init() (reliq_nmemo){ .hooks = flexarr_init(sizeof(struct nmemo_hook),-(1<<3)) }
+void reliq_nmemo_free(reliq_nmemo *memo);
+
 reliq_error *reliq_ncomp(const char *script, const size_t size, reliq_npattern *nodep);
-int reliq_nexec(const reliq *rq, const reliq_chnode *chnode, const reliq_chnode *parent, const reliq_npattern *nodep);
+int reliq_nexec(const reliq *rq, reliq_nmemo *memo, const reliq_chnode *chnode, const reliq_chnode *parent, const reliq_npattern *nodep);
 void reliq_nfree(reliq_npattern *nodep);
+uint8_t reliq_nskip(const reliq_npattern *nodep); //returns RELIQ_SKIP_ of nodes that nodep can't match nor depend on
+uint8_t reliq_ntypes(const reliq_npattern *nodep); //returns bits (1<<RELIQ_HNODE_TYPE_) of types of nodes that nodep can match
 
 #endif
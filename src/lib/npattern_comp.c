@@ -21,158 +21,68 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "reliq.h"
 #include "utils.h"
 #include "node_exec.h"
+#include "tags.h"
+#include "index.h"
 #include "npattern_intr.h"
 
 #define NODE_MATCHES_INC -8
 
-#define XN(x) h_##x
-#define X(x) static void XN(x)(const UNUSED reliq *rq, const UNUSED reliq_chnode *chnode, const UNUSED reliq_hnode *hnode, const UNUSED reliq_chnode *parent, char UNUSED const **src, size_t UNUSED *srcl)
-
-X(node_attributes) {
-  *srcl = hnode->attribsl;
-}
-
-X(node_insides) {
-  *src = hnode->insides.b;
-  *srcl = hnode->insides.s;
-}
-
-X(node_all) {
-  *src = hnode->all.b;
-  *srcl = hnode->all.s;
-}
-
-X(node_start) {
-  *src = reliq_hnode_starttag(hnode,srcl);
-}
-
-X(node_name) {
-  *src = hnode->tag.b;
-  *srcl = hnode->tag.s;
-}
-
-X(node_end_strip) {
-  *src = reliq_hnode_endtag_strip(hnode,srcl);
-}
-
-X(node_end) {
-  *src = reliq_hnode_endtag(hnode,srcl);
-}
-
-X(global_index) {
-  *srcl = chnode->all;
-}
-
-X(global_level_relative) {
-  if (parent) {
-    *srcl = chnode->lvl-parent->lvl;
-  } else
-    *srcl = chnode->lvl;
-}
-
-X(global_level) {
-  *srcl = chnode->lvl;
-}
-
-X(global_tag_count) {
-  *srcl = hnode->tag_count;
-}
-
-X(global_comments_count) {
-  *srcl = hnode->comment_count;
-}
-
-X(global_text_count) {
-  *srcl = hnode->text_count;
-}
-
-X(global_all_count) {
-  *srcl = hnode->tag_count+hnode->comment_count+hnode->text_count;
-}
-
-X(global_position_relative) {
-  if (parent) {
-    *srcl = chnode-parent;
-  } else
-    *srcl = chnode-rq->nodes;
-}
-
-X(global_position) {
-  *srcl = chnode-rq->nodes;
-}
-
-X(comment_all) {
-  *src = hnode->all.b;
-  *srcl = hnode->all.s;
-}
-
-X(comment_insides) {
-  *src = hnode->insides.b;
-  *srcl = hnode->insides.s;
-}
-
-X(text_all) {
-  *src = hnode->all.b;
-  *srcl = hnode->all.s;
-}
-
-#undef X
-
 const struct hook_t hooks_list[] = {
   //global matching
-  {{"l",1},H_GLOBAL|H_RANGE_SIGNED,(uintptr_t)XN(global_level_relative),0},
-  {{"L",1},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_level),0},
-  {{"c",1},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_tag_count),0},
-  {{"Cc",2},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_comments_count),0},
-  {{"Ct",2},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_text_count),0},
-  {{"Ca",2},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_all_count),0},
-  {{"p",1},H_GLOBAL|H_RANGE_SIGNED,(uintptr_t)XN(global_position_relative),0},
-  {{"P",1},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_position),0},
-  {{"I",1},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_index),0},
-
-  {{"levelrelative",13},H_GLOBAL|H_RANGE_SIGNED,(uintptr_t)XN(global_level_relative),0},
-  {{"level",5},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_level),0},
-  {{"count",5},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_tag_count),0},
-  {{"countcomments",13},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_comments_count),0},
-  {{"counttext",9},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_text_count),0},
-  {{"countall",8},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_all_count),0},
-  {{"positionrelative",16},H_GLOBAL|H_RANGE_SIGNED,(uintptr_t)XN(global_position_relative),0},
-  {{"position",8},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_position),0},
-  {{"index",5},H_GLOBAL|H_RANGE_UNSIGNED,(uintptr_t)XN(global_index),0},
+  {{"l",1},H_GLOBAL|H_RANGE_SIGNED,NF_LEVEL_RELATIVE,0},
+  {{"L",1},H_GLOBAL|H_RANGE_UNSIGNED,NF_LEVEL,0},
+  {{"c",1},H_GLOBAL|H_RANGE_UNSIGNED,NF_TAG_COUNT,0},
+  {{"Cc",2},H_GLOBAL|H_RANGE_UNSIGNED,NF_COMMENTS_COUNT,0},
+  {{"Ct",2},H_GLOBAL|H_RANGE_UNSIGNED,NF_TEXT_COUNT,0},
+  {{"Ca",2},H_GLOBAL|H_RANGE_UNSIGNED,NF_ALL_COUNT,0},
+  {{"p",1},H_GLOBAL|H_RANGE_SIGNED,NF_POSITION_RELATIVE,0},
+  {{"P",1},H_GLOBAL|H_RANGE_UNSIGNED,NF_POSITION,0},
+  {{"I",1},H_GLOBAL|H_RANGE_UNSIGNED,NF_INDEX,0},
+
+  {{"levelrelative",13},H_GLOBAL|H_RANGE_SIGNED,NF_LEVEL_RELATIVE,0},
+  {{"level",5},H_GLOBAL|H_RANGE_UNSIGNED,NF_LEVEL,0},
+  {{"count",5},H_GLOBAL|H_RANGE_UNSIGNED,NF_TAG_COUNT,0},
+  {{"countcomments",13},H_GLOBAL|H_RANGE_UNSIGNED,NF_COMMENTS_COUNT,0},
+  {{"counttext",9},H_GLOBAL|H_RANGE_UNSIGNED,NF_TEXT_COUNT,0},
+  {{"countall",8},H_GLOBAL|H_RANGE_UNSIGNED,NF_ALL_COUNT,0},
+  {{"positionrelative",16},H_GLOBAL|H_RANGE_SIGNED,NF_POSITION_RELATIVE,0},
+  {{"position",8},H_GLOBAL|H_RANGE_UNSIGNED,NF_POSITION,0},
+  {{"index",5},H_GLOBAL|H_RANGE_UNSIGNED,NF_INDEX,0},
 
   //node matching
-  {{"A",1},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_all),(uintptr_t)"uWcnas"},
-  {{"i",1},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_insides),(uintptr_t)"tWncas"},
-  {{"S",1},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_start),(uintptr_t)"uWcnas"},
-  {{"n",1},H_MATCH_NODE|H_PATTERN|H_MATCH_NODE_MAIN,(uintptr_t)XN(node_name),(uintptr_t)"uWinfs"},
-  {{"a",1},H_MATCH_NODE|H_RANGE_UNSIGNED,(uintptr_t)XN(node_attributes),0},
-  {{"E",1},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_end),(uintptr_t)"uWcnas"},
-  {{"e",1},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_end_strip),(uintptr_t)"tWcnfs"},
-
-  {{"all",3},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_all),(uintptr_t)"uWcnas"},
-  {{"insides",7},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_insides),(uintptr_t)"tWncas"},
-  {{"start",5},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_start),(uintptr_t)"uWcnas"},
-  {{"name",4},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_name),(uintptr_t)"uWinfs"},
-  {{"attributes",10},H_MATCH_NODE|H_RANGE_UNSIGNED,(uintptr_t)XN(node_attributes),0},
-  {{"end",3},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_end),(uintptr_t)"uWcnas"},
-  {{"endstrip",8},H_MATCH_NODE|H_PATTERN,(uintptr_t)XN(node_end_strip),(uintptr_t)"tWcnfs"},
-  {{"has",3},H_MATCH_NODE|H_EXPRS,(uintptr_t)NULL,0},
+  {{"A",1},H_MATCH_NODE|H_PATTERN,NF_ALL,(uintptr_t)"uWcnas"},
+  {{"i",1},H_MATCH_NODE|H_PATTERN,NF_INSIDES,(uintptr_t)"tWncas"},
+  {{"S",1},H_MATCH_NODE|H_PATTERN,NF_START,(uintptr_t)"uWcnas"},
+  {{"n",1},H_MATCH_NODE|H_PATTERN|H_MATCH_NODE_MAIN,NF_NAME,(uintptr_t)"uWinfs"},
+  {{"a",1},H_MATCH_NODE|H_RANGE_UNSIGNED,NF_ATTRIBUTES,0},
+  {{"E",1},H_MATCH_NODE|H_PATTERN,NF_END,(uintptr_t)"uWcnas"},
+  {{"e",1},H_MATCH_NODE|H_PATTERN,NF_END_STRIP,(uintptr_t)"tWcnfs"},
+
+  {{"all",3},H_MATCH_NODE|H_PATTERN,NF_ALL,(uintptr_t)"uWcnas"},
+  {{"insides",7},H_MATCH_NODE|H_PATTERN,NF_INSIDES,(uintptr_t)"tWncas"},
+  {{"start",5},H_MATCH_NODE|H_PATTERN,NF_START,(uintptr_t)"uWcnas"},
+  {{"name",4},H_MATCH_NODE|H_PATTERN,NF_NAME,(uintptr_t)"uWinfs"},
+  {{"attributes",10},H_MATCH_NODE|H_RANGE_UNSIGNED,NF_ATTRIBUTES,0},
+  {{"end",3},H_MATCH_NODE|H_PATTERN,NF_END,(uintptr_t)"uWcnas"},
+  {{"endstrip",8},H_MATCH_NODE|H_PATTERN,NF_END_STRIP,(uintptr_t)"tWcnfs"},
+  {{"has",3},H_MATCH_NODE|H_EXPRS,NF_NONE,0},
 
   //comment matching
-  {{"A",1},H_MATCH_COMMENT|H_PATTERN|H_MATCH_COMMENT_MAIN,(uintptr_t)XN(comment_all),(uintptr_t)"tWncas"},
-  {{"i",1},H_MATCH_COMMENT|H_PATTERN,(uintptr_t)XN(comment_insides),(uintptr_t)"tWncas"},
+  {{"A",1},H_MATCH_COMMENT|H_PATTERN|H_MATCH_COMMENT_MAIN,NF_ALL,(uintptr_t)"tWncas"},
+  {{"i",1},H_MATCH_COMMENT|H_PATTERN,NF_INSIDES,(uintptr_t)"tWncas"},
 
-  {{"all",3},H_MATCH_COMMENT|H_PATTERN,(uintptr_t)XN(comment_all),(uintptr_t)"tWncas"},
-  {{"insides",7},H_MATCH_COMMENT|H_PATTERN,(uintptr_t)XN(comment_insides),(uintptr_t)"tWncas"},
+  {{"all",3},H_MATCH_COMMENT|H_PATTERN,NF_ALL,(uintptr_t)"tWncas"},
+  {{"insides",7},H_MATCH_COMMENT|H_PATTERN,NF_INSIDES,(uintptr_t)"tWncas"},
 
   //text matching
-  {{"A",1},H_MATCH_TEXT|H_PATTERN|H_MATCH_TEXT_MAIN,(uintptr_t)XN(text_all),(uintptr_t)"tWncas"},
+  {{"A",1},H_MATCH_TEXT|H_PATTERN|H_MATCH_TEXT_MAIN,NF_ALL,(uintptr_t)"tWncas"},
 
-  {{"all",3},H_MATCH_TEXT|H_PATTERN,(uintptr_t)XN(text_all),(uintptr_t)"tWncas"},
+  {{"all",3},H_MATCH_TEXT|H_PATTERN,NF_ALL,(uintptr_t)"tWncas"},
 
   //access
   {{"",0},H_ACCESS|H_NOARG,AXIS_SELF,0},
@@ -214,7 +124,26 @@ const struct hook_t hooks_list[] = {
   {{"textall",7},H_TYPE|H_NOARG,NM_TEXT_ALL,0},
 };
 
-#undef XN
+//returns RELIQ_SKIP_ of nodes that don't change result of hook
+static uint8_t
+hook_skip(const reliq_hook *hook)
+{
+  const hook_t *h = hook->hook;
+  if (h->flags&H_EXPRS)
+    return reliq_expr_skip(&hook->match.expr);
+  if (!(h->flags&H_GLOBAL))
+    return RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY|RELIQ_SKIP_COMMENTS;
+
+  if (h->arg1 == NF_COMMENTS_COUNT)
+    return RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY;
+  if (h->arg1 == NF_TEXT_COUNT)
+    return RELIQ_SKIP_COMMENTS;
+  if (h->arg1 == NF_ALL_COUNT
+    || h->arg1 == NF_POSITION
+    || h->arg1 == NF_POSITION_RELATIVE)
+    return 0;
+  return RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY|RELIQ_SKIP_COMMENTS;
+}
 
 struct nmatchers_state {
   nmatchers *matches;
@@ -261,7 +190,7 @@ free_nmatchers_group(nmatchers_groups *groups)
   nmatchers *list = groups->list;
   for (size_t i = 0; i < size; i++)
     free_nmatchers(&list[i]);
-  free(list);
+  mem_free(list);
 }
 
 static void
@@ -274,19 +203,27 @@ free_nmatchers(nmatchers *matches)
     switch (node->type) {
       case MATCHES_TYPE_HOOK:
         reliq_free_hook(node->data.hook);
-        free(node->data.hook);
+        mem_free(node->data.hook);
         break;
       case MATCHES_TYPE_ATTRIB:
         pattrib_free(node->data.attrib);
-        free(node->data.attrib);
+        mem_free(node->data.attrib);
         break;
       case MATCHES_TYPE_GROUPS:
         free_nmatchers_group(node->data.groups);
-        free(node->data.groups);
+        mem_free(node->data.groups);
+        break;
+      case MATCHES_TYPE_TAG:
+        mem_free(node->data.tag->name.b);
+        mem_free(node->data.tag);
+        break;
+      case MATCHES_TYPE_TOKEN:
+        mem_free(node->data.token->name.b);
+        mem_free(node->data.token);
         break;
     }
   }
-  free(list);
+  mem_free(list);
 }
 
 void
@@ -301,6 +238,7 @@ reliq_nfree(reliq_npattern *nodep)
     return;
 
   free_nmatchers(&nodep->matches);
+  mem_free(nodep->code);
 }
 
 static const char *
@@ -371,13 +309,14 @@ match_hook_handle_expr(const char *src, const size_t size, size_t *pos, reliq_ho
   if ((err = get_quoted(src,&i,size,' ',&str,&strl)) || !strl)
     goto ERR;
   err = reliq_ecomp_intr(str,strl,&hook->match.expr);
-  free(str);
+  mem_free(str);
   if (err)
     goto ERR;
   if ((err = expr_check_chain(&hook->match.expr))) {
     reliq_efree_intr(&hook->match.expr);
     goto ERR;
   }
+  hook->memo = !expr_uses_parent(&hook->match.expr);
 
   ERR: ;
   *pos = i;
@@ -491,6 +430,43 @@ nmatchers_node_add(flexarr *arr, uint8_t type, void *data, const size_t size) //
   new->data.hook = memdup(data,size);
 }
 
+//converts hook matching plain name without case distinction to ptag
+static bool
+ptag_from_hook(const reliq_hook *hook, struct ptag *tag)
+{
+  if (hook->hook->arg1 != NF_NAME)
+    return 0;
+
+  const reliq_pattern *p = &hook->match.pattern;
+  const uint16_t flags = p->flags;
+  if ((flags&RELIQ_PATTERN_TYPE) != RELIQ_PATTERN_TYPE_STR
+    || (flags&RELIQ_PATTERN_MATCH) != RELIQ_PATTERN_MATCH_FULL
+    || !(flags&RELIQ_PATTERN_CASE_INSENSITIVE)
+    || flags&(RELIQ_PATTERN_EMPTY|RELIQ_PATTERN_ALL)
+    || p->range.s || !p->match.str.s)
+    return 0;
+
+  const reliq_str name = p->match.str;
+  *tag = (struct ptag){
+    .name = name,
+    .hash = index_name_hash(name.b,name.s),
+    .tag = tag_find(name.b,name.s),
+    .invert = hook->invert^((flags&RELIQ_PATTERN_INVERT) ? 1 : 0)
+  };
+  return 1;
+}
+
+static void
+nmatchers_hook_add(flexarr *arr, reliq_hook *hook) //arr: nmatchers_node
+{
+  struct ptag tag;
+  if (ptag_from_hook(hook,&tag)) {
+    nmatchers_node_add(arr,MATCHES_TYPE_TAG,&tag,sizeof(struct ptag));
+    return;
+  }
+  nmatchers_node_add(arr,MATCHES_TYPE_HOOK,hook,sizeof(reliq_hook));
+}
+
 static void
 free_node_matches_flexarr(flexarr *groups_matches) //group_matches: nmatchers
 {
@@ -730,7 +706,7 @@ hook_add(size_t *pos, const bool invert, flexarr *result, struct nmatchers_state
 
   hook.invert = invert;
 
-  nmatchers_node_add(result,MATCHES_TYPE_HOOK,&hook,sizeof(reliq_hook));
+  nmatchers_hook_add(result,&hook);
 
   if (hflags&(H_MATCH_NODE|H_MATCH_COMMENT|H_MATCH_TEXT))
     return 2;
@@ -766,10 +742,40 @@ comp_node_add_tag(const char *src, size_t *pos, const size_t size, const bool in
       .invert = invert,
       .hook = hook
   };
-  nmatchers_node_add(result,MATCHES_TYPE_HOOK,&h,sizeof(reliq_hook));
+  nmatchers_hook_add(result,&h);
   return NULL;
 }
 
+//converts .class and #id shortcuts matching plain word to ptoken
+static bool
+ptoken_from_attrib(const struct pattrib *attrib, const char shortcut, struct ptoken *token)
+{
+  if (shortcut != '.' && shortcut != '#')
+    return 0;
+  if (attrib->position.s)
+    return 0;
+
+  const reliq_pattern *p = &attrib->r[1];
+  const uint16_t flags = p->flags;
+  if ((flags&RELIQ_PATTERN_TYPE) != RELIQ_PATTERN_TYPE_STR
+    || (flags&RELIQ_PATTERN_MATCH) != RELIQ_PATTERN_MATCH_FULL
+    || (flags&RELIQ_PATTERN_PASS) != RELIQ_PATTERN_PASS_WORD
+    || flags&(RELIQ_PATTERN_CASE_INSENSITIVE|RELIQ_PATTERN_INVERT
+      |RELIQ_PATTERN_EMPTY|RELIQ_PATTERN_ALL)
+    || p->range.s || !p->match.str.s)
+    return 0;
+
+  const reliq_str name = p->match.str;
+  const uint8_t kind = (shortcut == '.') ? INDEX_TOKEN_CLASS : INDEX_TOKEN_ID;
+  *token = (struct ptoken){
+    .name = name,
+    .hash = index_token_hash(kind,name.b,name.s),
+    .kind = kind,
+    .invert = (attrib->flags&A_INVERT) ? 1 : 0
+  };
+  return 1;
+}
+
 static reliq_error *
 comp_node(const char *src, size_t *pos, const size_t size, bool invert, bool *hastag, flexarr *result) //result: nmatchers_node
 {
@@ -844,6 +850,14 @@ comp_node(const char *src, size_t *pos, const size_t size, bool invert, bool *ha
   if (i < size && src[i] != '+' && src[i] != '-')
     i++;
 
+  struct ptoken token;
+  if (ptoken_from_attrib(&attrib,shortcut,&token)) {
+    nmatchers_node_add(result,MATCHES_TYPE_TOKEN,&token,sizeof(struct ptoken));
+    reliq_regfree(&attrib.r[0]); //value is owned by token
+    tofree = 0;
+    goto END;
+  }
+
   ADD_ATTRIB: ;
   tofree = 0;
   nmatchers_node_add(result,MATCHES_TYPE_ATTRIB,&attrib,sizeof(struct pattrib));
@@ -1041,6 +1055,362 @@ handle_nmatchers(size_t *pos, struct nmatchers_state *st)
   *pos = i;
 }
 
+static const struct ptag *
+required_tag(const nmatchers *matches)
+{
+  const size_t size = matches->size;
+  const nmatchers_node *list = matches->list;
+  for (size_t i = 0; i < size; i++)
+    if (list[i].type == MATCHES_TYPE_TAG && !list[i].data.tag->invert)
+      return list[i].data.tag;
+  return NULL;
+}
+
+static const struct ptoken *
+required_token(const nmatchers *matches)
+{
+  const size_t size = matches->size;
+  const nmatchers_node *list = matches->list;
+  for (size_t i = 0; i < size; i++)
+    if (list[i].type == MATCHES_TYPE_TOKEN && !list[i].data.token->invert)
+      return list[i].data.token;
+  return NULL;
+}
+
+static uint8_t
+nmatchers_type_skip(const uint8_t type)
+{
+  switch (type) {
+    case NM_DEFAULT:
+    case NM_TAG:
+    case NM_MULTIPLE: //types of its groups are checked separately
+      return RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY|RELIQ_SKIP_COMMENTS;
+    case NM_COMMENT:
+      return RELIQ_SKIP_TEXT|RELIQ_SKIP_TEXT_EMPTY;
+    case NM_TEXT_EMPTY:
+    case NM_TEXT_ALL:
+      return RELIQ_SKIP_COMMENTS;
+    default:
+      return RELIQ_SKIP_TEXT_EMPTY|RELIQ_SKIP_COMMENTS;
+  }
+}
+
+static uint8_t
+nmatchers_skip(const nmatchers *matches)
+{
+  uint8_t skip = nmatchers_type_skip(matches->type);
+  const size_t size = matches->size;
+  const nmatchers_node *list = matches->list;
+  for (size_t i = 0; i < size && skip; i++) {
+    if (list[i].type == MATCHES_TYPE_HOOK) {
+      skip &= hook_skip(list[i].data.hook);
+    } else if (list[i].type == MATCHES_TYPE_GROUPS) {
+      const nmatchers_groups *groups = list[i].data.groups;
+      for (size_t j = 0; j < groups->size; j++)
+        skip &= nmatchers_skip(&groups->list[j]);
+    }
+  }
+  return skip;
+}
+
+uint8_t
+reliq_nskip(const reliq_npattern *nodep)
+{
+  //empty pattern matches nodes of every type
+  if (nodep->flags&N_EMPTY)
+    return 0;
+  return nmatchers_skip(&nodep->matches);
+}
+
+static uint8_t
+pattern_cost(const reliq_pattern *pattern)
+{
+  const uint16_t type = pattern->flags&RELIQ_PATTERN_TYPE;
+  if (pattern->flags&(RELIQ_PATTERN_ALL|RELIQ_PATTERN_EMPTY) || type == RELIQ_PATTERN_TYPE_STR)
+    return NCOST_LITERAL;
+  return NCOST_REGEX;
+}
+
+static uint8_t
+hook_cost(const reliq_hook *hook)
+{
+  const uint16_t flags = hook->hook->flags;
+  if (flags&H_EXPRS)
+    return NCOST_EXPRS;
+  if (flags&H_PATTERN)
+    return pattern_cost(&hook->match.pattern);
+  return NCOST_RANGE;
+}
+
+static uint8_t
+pattrib_cost(const struct pattrib *attrib)
+{
+  if (pattern_cost(&attrib->r[0]) == NCOST_REGEX
+    || (attrib->flags&A_VAL_MATTERS && pattern_cost(&attrib->r[1]) == NCOST_REGEX))
+    return NCOST_REGEX;
+  return NCOST_ATTRIB;
+}
+
+static uint8_t nmatchers_groups_order(nmatchers_groups *groups);
+
+static uint8_t
+nmatchers_node_cost(nmatchers_node *node)
+{
+  switch (node->type) {
+    case MATCHES_TYPE_HOOK:
+      return hook_cost(node->data.hook);
+    case MATCHES_TYPE_ATTRIB:
+      return pattrib_cost(node->data.attrib);
+    case MATCHES_TYPE_GROUPS:
+      return nmatchers_groups_order(node->data.groups);
+    case MATCHES_TYPE_TAG:
+      return NCOST_TAG;
+    default: //MATCHES_TYPE_TOKEN
+      return NCOST_LITERAL;
+  }
+}
+
+//cost of the most expensive matcher, matches have to be ordered by nmatchers_order()
+static inline uint8_t
+nmatchers_cost(const nmatchers *matches)
+{
+  return matches->size ? matches->list[matches->size-1].cost : NCOST_TAG;
+}
+
+/*
+  Sorts matchers by their cost, matchers of the same cost keep their order.
+  Matchers don't have side effects so their order doesn't change the result.
+  Returns cost of the most expensive matcher.
+*/
+static uint8_t
+nmatchers_order(nmatchers *matches)
+{
+  const size_t size = matches->size;
+  nmatchers_node *list = matches->list;
+  for (size_t i = 0; i < size; i++) {
+    nmatchers_node node = list[i];
+    node.cost = nmatchers_node_cost(&node);
+
+    size_t j = i;
+    for (; j > 0 && list[j-1].cost > node.cost; j--)
+      list[j] = list[j-1];
+    list[j] = node;
+  }
+  return nmatchers_cost(matches);
+}
+
+//orders alternatives of groups by cost of their most expensive matcher, returns the highest of them
+static uint8_t
+nmatchers_groups_order(nmatchers_groups *groups)
+{
+  const size_t size = groups->size;
+  nmatchers *list = groups->list;
+  uint8_t max = NCOST_TAG;
+  for (size_t i = 0; i < size; i++) {
+    nmatchers matches = list[i];
+    const uint8_t cost = nmatchers_order(&matches);
+    if (cost > max)
+      max = cost;
+
+    size_t j = i;
+    for (; j > 0 && nmatchers_cost(&list[j-1]) > cost; j--)
+      list[j] = list[j-1];
+    list[j] = matches;
+  }
+  return max;
+}
+
+static uint32_t
+ncode_add(flexarr *code, const uint8_t op, const void *arg, const uint8_t field) //code: struct ninstr
+{
+  struct ninstr *in = flexarr_inc(code);
+  *in = (struct ninstr){ .op = op, .field = field };
+  in->arg.hook = arg;
+  return code->size-1;
+}
+
+//adds test to code, its position is added to fails
+static void
+ncode_test(flexarr *code, flexarr *fails, const uint8_t op, const void *arg, const uint8_t field) //code: struct ninstr, fails: uint32_t
+{
+  *(uint32_t*)flexarr_inc(fails) = ncode_add(code,op,arg,field);
+}
+
+//sets target of instructions at positions from fails
+static void
+ncode_patch(flexarr *code, flexarr *fails, const uint32_t target) //code: struct ninstr, fails: uint32_t
+{
+  struct ninstr *v = code->v;
+  const uint32_t *f = fails->v;
+  for (size_t i = 0; i < fails->size; i++)
+    v[f[i]].target = target;
+  fails->size = 0;
+}
+
+static void
+ncode_hook(flexarr *code, flexarr *fails, const reliq_hook *hook) //code: struct ninstr, fails: uint32_t
+{
+  const uint16_t flags = hook->hook->flags;
+  uint8_t op;
+  if (flags&H_EXPRS) {
+    op = NOP_EXPRS;
+  } else if (flags&H_PATTERN) {
+    op = NOP_PATTERN;
+  } else if (flags&H_RANGE_SIGNED) {
+    op = NOP_RANGE_SIGNED;
+  } else if (flags&H_RANGE_UNSIGNED) {
+    op = NOP_RANGE_UNSIGNED;
+  } else
+    return;
+
+  ncode_test(code,fails,op,hook,hook->hook->arg1);
+}
+
+static void ncode_nmatchers(flexarr *code, flexarr *fails, const nmatchers *matches, const bool type);
+
+static void
+ncode_groups(flexarr *code, flexarr *fails, const nmatchers_groups *groups) //code: struct ninstr, fails: uint32_t
+{
+  const size_t size = groups->size;
+  if (!size) {
+    ncode_test(code,fails,NOP_JUMP,NULL,0);
+    return;
+  }
+
+  flexarr passes = flexarr_init(sizeof(uint32_t),NODE_MATCHES_INC);
+  flexarr altfails = flexarr_init(sizeof(uint32_t),NODE_MATCHES_INC);
+  for (size_t i = 0; i < size-1; i++) {
+    ncode_nmatchers(code,&altfails,&groups->list[i],1);
+    *(uint32_t*)flexarr_inc(&passes) = ncode_add(code,NOP_JUMP,NULL,0);
+    ncode_patch(code,&altfails,code->size);
+  }
+  //failure of the last alternative fails the whole group
+  ncode_nmatchers(code,fails,&groups->list[size-1],1);
+  ncode_patch(code,&passes,code->size);
+
+  flexarr_free(&passes);
+  flexarr_free(&altfails);
+}
+
+//type of matches is tested only if type is set
+static void
+ncode_nmatchers(flexarr *code, flexarr *fails, const nmatchers *matches, const bool type) //code: struct ninstr, fails: uint32_t
+{
+  if (type && matches->type != NM_MULTIPLE)
+    ncode_test(code,fails,NOP_TYPE,NULL,matches->type);
+
+  const size_t size = matches->size;
+  const nmatchers_node *list = matches->list;
+  for (size_t i = 0; i < size; i++) {
+    switch (list[i].type) {
+      case MATCHES_TYPE_HOOK:
+        ncode_hook(code,fails,list[i].data.hook);
+        break;
+      case MATCHES_TYPE_ATTRIB:
+        ncode_test(code,fails,NOP_ATTRIB,list[i].data.attrib,0);
+        break;
+      case MATCHES_TYPE_GROUPS:
+        ncode_groups(code,fails,list[i].data.groups);
+        break;
+      case MATCHES_TYPE_TAG:
+        ncode_test(code,fails,NOP_TAG,list[i].data.tag,0);
+        break;
+      case MATCHES_TYPE_TOKEN:
+        ncode_test(code,fails,NOP_TOKEN,list[i].data.token,0);
+        break;
+    }
+  }
+}
+
+static struct ninstr *
+ncode_comp(const nmatchers *matches)
+{
+  flexarr code = flexarr_init(sizeof(struct ninstr),NODE_MATCHES_INC);
+  flexarr fails = flexarr_init(sizeof(uint32_t),NODE_MATCHES_INC);
+
+  //failing tests go to the start so that reliq_nexec() can return without jumping there
+  ncode_add(&code,NOP_REJECT,NULL,0);
+  //type of node is tested by reliq_nexec() before code is executed
+  ncode_nmatchers(&code,&fails,matches,0);
+  ncode_add(&code,NOP_ACCEPT,NULL,0);
+  ncode_patch(&code,&fails,0);
+
+  flexarr_free(&fails);
+  struct ninstr *ret;
+  size_t retl;
+  flexarr_conv(&code,(void**)&ret,&retl);
+  return ret;
+}
+
+#ifdef NPATTERN_DEBUG
+
+static void
+nmatchers_print_tab(size_t tab)
+{
+  for (size_t j = 0; j < tab; j++)
+    fputs("  ",stderr);
+}
+
+static void
+nmatchers_print(const nmatchers *matches, size_t tab)
+{
+  const size_t size = matches->size;
+  const nmatchers_node *list = matches->list;
+  for (size_t i = 0; i < size; i++) {
+    const nmatchers_node *node = &list[i];
+    nmatchers_print_tab(tab);
+    fprintf(stderr,"\033[;1m%u\033[0m ",node->cost);
+    switch (node->type) {
+      case MATCHES_TYPE_HOOK:
+        fprintf(stderr,"%s%s@\n",node->data.hook->invert ? "-" : "",node->data.hook->hook->name.b);
+        break;
+      case MATCHES_TYPE_ATTRIB:
+        fputs("attrib\n",stderr);
+        break;
+      case MATCHES_TYPE_TAG:
+        fprintf(stderr,"%stag %.*s\n",node->data.tag->invert ? "-" : "",(int)node->data.tag->name.s,node->data.tag->name.b);
+        break;
+      case MATCHES_TYPE_TOKEN:
+        fprintf(stderr,"%stoken %.*s\n",node->data.token->invert ? "-" : "",(int)node->data.token->name.s,node->data.token->name.b);
+        break;
+      case MATCHES_TYPE_GROUPS: {
+        const nmatchers_groups *groups = node->data.groups;
+        fputs("\033[36m(\033[0m\n",stderr);
+        for (size_t j = 0; j < groups->size; j++) {
+          if (j) {
+            nmatchers_print_tab(tab);
+            fputs("\033[36m)(\033[0m\n",stderr);
+          }
+          nmatchers_print(&groups->list[j],tab+1);
+        }
+        nmatchers_print_tab(tab);
+        fputs("\033[36m)\033[0m\n",stderr);
+        break;
+      }
+    }
+  }
+}
+
+static void
+ncode_print(const struct ninstr *code)
+{
+  static const char *names[] = {"accept","reject","jump","type","tag","token",
+    "attrib","range_signed","range_unsigned","pattern","exprs"};
+  for (size_t i = 0; ; i++) {
+    const struct ninstr *in = &code[i];
+    fprintf(stderr,"\033[;1m%3lu\033[0m %s",i,names[in->op]);
+    if (in->op != NOP_JUMP && in->op >= NOP_TYPE)
+      fprintf(stderr," %u",in->field);
+    if (in->op >= NOP_JUMP)
+      fprintf(stderr," \033[35m-> %u\033[0m",in->target);
+    fputc('\n',stderr);
+    if (in->op == NOP_ACCEPT)
+      break;
+  }
+}
+
+#endif //NPATTERN_DEBUG
+
 reliq_error *
 reliq_ncomp(const char *script, const size_t size, reliq_npattern *nodep)
 {
@@ -1071,9 +1441,21 @@ reliq_ncomp(const char *script, const size_t size, reliq_npattern *nodep)
     reliq_nfree(nodep);
   } else {
     nodep->position_max = predict_range_max(&nodep->position);
+    if (!(nodep->flags&N_EMPTY)) {
+      nmatchers_order(&nodep->matches);
+      nodep->code = ncode_comp(&nodep->matches);
+      #ifdef NPATTERN_DEBUG
+      RELIQ_DEBUG_SECTION_HEADER("NPATTERN");
+      nmatchers_print(&nodep->matches,0);
+      ncode_print(nodep->code);
+      #endif
+      nodep->tag = required_tag(&nodep->matches);
+      nodep->token = required_token(&nodep->matches);
+    }
     if (st.axisflags == 0)
       st.axisflags = AXIS_SELF|AXIS_DESCENDANTS;
-    axis_comp_functions(st.axisflags,(void*)&nodep->axis_funcs);
+    if (axis_comp_functions(st.axisflags,(void*)&nodep->axis_funcs))
+      nodep->flags |= N_PARENT;
   }
 
   return st.err;
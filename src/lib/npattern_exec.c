@@ -19,27 +19,109 @@
 #include "../ext.h"
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "alloc.h"
 #include "reliq.h"
 #include "range.h"
 #include "node_exec.h"
+#include "index.h"
 #include "npattern_intr.h"
 
-typedef void (*hook_func_t)(const reliq *rq, const reliq_chnode *chnode, const reliq_hnode *hnode, const reliq_chnode *parent, char const **src, size_t *srcl);
+//fills only .all and .insides of hnode, which is enough for reliq_hnode_*tag()
+static void
+hnode_insides(const reliq *rq, const reliq_chnode *chnode, reliq_hnode *hnode)
+{
+  const char *base = rq->data+chnode->all;
+  hnode->all = (reliq_cstr){ .b = base, .s = chnode->all_len };
 
-typedef struct  {
-  const reliq *rq;
-  const reliq_chnode *chnode;
-  const reliq_chnode *parent;
-  const reliq_hnode *hnode;
-} nmatcher_state;
+  const reliq_off insides = reliq_chnode_insides(rq,chnode,reliq_chnode_type(chnode));
+  if (insides == 0 && chnode->endtag == 0) {
+    hnode->insides = (reliq_cstr){NULL,0};
+    return;
+  }
+  if (chnode->tag)
+    base += chnode->tag+chnode->tagl;
+  hnode->insides = (reliq_cstr){ .b = base+insides, .s = chnode->endtag-insides };
+}
+
+/*
+  Reads field of chnode matched by hook, fields are taken straight from
+  chnode and only those that need insides of node convert it by hnode_insides().
+*/
+static inline void
+nfield_load(const reliq *rq, const reliq_chnode *chnode, const reliq_chnode *parent, const uint8_t field, char const **src, size_t *srcl)
+{
+  reliq_hnode hnode;
+  *src = NULL;
+  *srcl = 0;
+  switch (field) {
+    case NF_ATTRIBUTES:
+      *srcl = reliq_chnode_attribsl(rq,chnode);
+      break;
+    case NF_INSIDES:
+      hnode_insides(rq,chnode,&hnode);
+      *src = hnode.insides.b;
+      *srcl = hnode.insides.s;
+      break;
+    case NF_ALL:
+      *src = rq->data+chnode->all;
+      *srcl = chnode->all_len;
+      break;
+    case NF_START:
+      hnode_insides(rq,chnode,&hnode);
+      *src = reliq_hnode_starttag(&hnode,srcl);
+      break;
+    case NF_NAME:
+      if (chnode->tag) {
+        *src = rq->data+chnode->all+chnode->tag;
+        *srcl = chnode->tagl;
+      }
+      break;
+    case NF_END:
+      hnode_insides(rq,chnode,&hnode);
+      *src = reliq_hnode_endtag(&hnode,srcl);
+      break;
+    case NF_END_STRIP:
+      hnode_insides(rq,chnode,&hnode);
+      *src = reliq_hnode_endtag_strip(&hnode,srcl);
+      break;
+    case NF_INDEX:
+      *srcl = chnode->all;
+      break;
+    case NF_LEVEL:
+      *srcl = chnode->lvl;
+      break;
+    case NF_LEVEL_RELATIVE:
+      *srcl = parent ? chnode->lvl-parent->lvl : chnode->lvl;
+      break;
+    case NF_TAG_COUNT:
+      *srcl = chnode->tag_count;
+      break;
+    case NF_COMMENTS_COUNT:
+      *srcl = chnode->comment_count;
+      break;
+    case NF_TEXT_COUNT:
+      *srcl = chnode->text_count;
+      break;
+    case NF_ALL_COUNT:
+      *srcl = chnode->tag_count+chnode->comment_count+chnode->text_count;
+      break;
+    case NF_POSITION:
+      *srcl = chnode-rq->nodes;
+      break;
+    case NF_POSITION_RELATIVE:
+      *srcl = parent ? chnode-parent : chnode-rq->nodes;
+      break;
+  }
+}
 
 static int
-pattrib_match(const reliq *rq, const reliq_hnode *hnode, const struct pattrib *attrib)
+pattrib_match(const reliq *rq, const reliq_chnode *chnode, const struct pattrib *attrib)
 {
   bool found = 0;
-  const reliq_cattrib *a = hnode->attribs;
-  const uint32_t attribsl = hnode->attribsl;
+  const reliq_cattrib *a = rq->attribs+chnode->attribs;
+  const uint32_t attribsl = reliq_chnode_attribsl(rq,chnode);
 
   for (uint32_t i = 0; i < attribsl; i++) {
     if (!range_match(i,&attrib->position,attribsl-1))
@@ -64,61 +146,111 @@ pattrib_match(const reliq *rq, const reliq_hnode *hnode, const struct pattrib *a
 }
 
 static int
-exprs_match(const reliq *rq, const reliq_chnode *chnode, const reliq_chnode *parent, const reliq_hook *hook)
+ptag_match(const reliq *rq, const reliq_chnode *chnode, const struct ptag *tag)
 {
-  size_t compressedl = 0;
-  reliq_compressed input = { .hnode = chnode-rq->nodes, .parent = parent ? parent-rq->nodes : (uint32_t)-1 };
-  reliq_error *err = reliq_exec_r(rq,&input,1,&hook->match.expr,NULL,NULL,&compressedl);
-  if (err)
-    free(err);
-  if (err || !compressedl)
-    return 0;
-  return 1;
+  bool found;
+  if (rq->index) {
+    const uint32_t atom = rq->index->atoms[chnode-rq->nodes];
+    found = index_atom_eq(rq->index,atom,tag->tag,tag->hash,tag->name.b,tag->name.s);
+  } else
+    found = (chnode->tag && memcaseeq(rq->data+chnode->all+chnode->tag,tag->name.b,chnode->tagl,tag->name.s));
+  return found^tag->invert;
 }
 
-static int
-match_hook(const nmatcher_state *st, const reliq_hook *hook)
+static bool
+ptoken_find(const reliq *rq, const reliq_chnode *chnode, const struct ptoken *token)
 {
-  char const *src = NULL;
-  size_t srcl = 0;
-  uint16_t flags = hook->hook->flags;
-  const bool invert = hook->invert;
-  const reliq *rq = st->rq;
-  const reliq_chnode *chnode = st->chnode;
-  const reliq_chnode *parent = st->parent;
-  const reliq_hnode *hnode = st->hnode;
-
-  const uintptr_t arg = hook->hook->arg1;
-  if (arg)
-    ((hook_func_t)arg)(rq,chnode,hnode,parent,&src,&srcl);
-
-  if (flags&H_RANGE_UNSIGNED) {
-    if ((!range_match(srcl,&hook->match.range,RANGE_UNSIGNED))^invert)
-      return 0;
-  } else if (flags&H_RANGE_SIGNED) {
-    if ((!range_match(srcl,&hook->match.range,RANGE_SIGNED))^invert)
-      return 0;
-  } else if (flags&H_PATTERN) {
-    if ((!reliq_regexec(&hook->match.pattern,src,srcl))^invert)
-      return 0;
-  } else if (flags&H_EXPRS) {
-    if (!exprs_match(rq,chnode,parent,hook)^invert)
-      return 0;
+  const bool isclass = (token->kind == INDEX_TOKEN_CLASS);
+  const reliq_cattrib *a = rq->attribs+chnode->attribs;
+  const uint32_t attribsl = reliq_chnode_attribsl(rq,chnode);
+
+  for (uint32_t i = 0; i < attribsl; i++) {
+    const char *base = rq->data+a[i].key;
+    if (!memcaseeq(base,isclass ? "class" : "id",a[i].keyl,isclass ? 5 : 2))
+      continue;
+
+    const char *ptr = base+a[i].keyl+a[i].value;
+    char const *saveptr,*word;
+    size_t saveptrlen,wordlen;
+    while (1) {
+      memwordtok_r(ptr,a[i].valuel,&saveptr,&saveptrlen,&word,&wordlen);
+      if (!word)
+        break;
+      if (wordlen == token->name.s && memcmp(word,token->name.b,wordlen) == 0)
+        return 1;
+      ptr = NULL;
+    }
   }
-  return 1;
+  return 0;
 }
 
-static int nmatcher_match(const nmatcher_state *st, const nmatchers *matchers);
-
 static int
-nmatcher_groups_match(const nmatcher_state *st, const nmatchers_groups *groups)
+ptoken_match(const reliq *rq, const reliq_chnode *chnode, const struct ptoken *token)
+{
+  bool found;
+  if (rq->index) {
+    size_t count;
+    const uint32_t *nodes = index_token_nodes(rq,token->kind,token->hash,token->name.b,token->name.s,&count);
+    const uint32_t pos = chnode-rq->nodes;
+    const size_t i = index_nodes_lower_bound(nodes,count,pos);
+    found = (i < count && nodes[i] == pos);
+  } else
+    found = ptoken_find(rq,chnode,token);
+  return found^token->invert;
+}
+
+void
+reliq_nmemo_free(reliq_nmemo *memo)
 {
-  const size_t size = groups->size;
-  const nmatchers *list = groups->list;
+  const struct nmemo_hook *hooks = memo->hooks.v;
+  const size_t size = memo->hooks.size;
   for (size_t i = 0; i < size; i++)
-    if (nmatcher_match(st,&list[i]))
-      return 1;
-  return 0;
+    mem_free(hooks[i].bits);
+  flexarr_free(&memo->hooks);
+}
+
+//returns bitsets of hook, or NULL if results can't be remembered
+static uint64_t *
+nmemo_get(const reliq *rq, reliq_nmemo *memo, const reliq_hook *hook)
+{
+  if (!hook->memo || !memo)
+    return NULL;
+
+  flexarr *hooks = &memo->hooks; //struct nmemo_hook
+  struct nmemo_hook *h = hooks->v;
+  const size_t size = hooks->size;
+  for (size_t i = 0; i < size; i++)
+    if (h[i].hook == hook)
+      return h[i].bits;
+
+  h = flexarr_inc(hooks);
+  h->hook = hook;
+  h->bits = mem_calloc(((rq->nodesl+63)>>6)*2,sizeof(uint64_t));
+  return h->bits;
+}
+
+static int
+exprs_match(const reliq *rq, reliq_nmemo *memo, const reliq_chnode *chnode, const reliq_chnode *parent, const reliq_hook *hook)
+{
+  const uint32_t pos = chnode-rq->nodes;
+  uint64_t *evaluated = nmemo_get(rq,memo,hook);
+  uint64_t *result = NULL;
+  const uint64_t bit = (uint64_t)1<<(pos&63);
+  if (evaluated) {
+    result = evaluated+((rq->nodesl+63)>>6);
+    if (evaluated[pos>>6]&bit)
+      return ((result[pos>>6]&bit) != 0);
+  }
+
+  reliq_compressed input = { .hnode = pos, .parent = parent ? parent-rq->nodes : (uint32_t)-1 };
+  const bool found = reliq_exec_any(rq,memo,&input,&hook->match.expr);
+
+  if (evaluated) {
+    evaluated[pos>>6] |= bit;
+    if (found)
+      result[pos>>6] |= bit;
+  }
+  return found;
 }
 
 static inline int
@@ -155,47 +287,74 @@ nmatcher_match_type(const uint8_t hnode_type, const uint8_t type)
   return (istextempty|istexterr|istext);
 }
 
-static int
-nmatcher_match(const nmatcher_state *st, const nmatchers *matchers)
+uint8_t
+reliq_ntypes(const reliq_npattern *nodep)
+{
+  uint8_t ret = 0;
+  for (uint8_t i = RELIQ_HNODE_TYPE_TAG; i <= RELIQ_HNODE_TYPE_TEXT_ERR; i++)
+    if (nodep->flags&N_EMPTY || nmatcher_match_type(i,nodep->matches.type))
+      ret |= 1<<i;
+  return ret;
+}
+
+int
+reliq_nexec(const reliq *rq, reliq_nmemo *memo, const reliq_chnode *chnode, const reliq_chnode *parent, const reliq_npattern *nodep)
 {
-  const size_t size = matchers->size;
-  nmatchers_node *list = matchers->list;
+  if (nodep->flags&N_EMPTY)
+    return 1;
 
-  if (!nmatcher_match_type(st->hnode->type,matchers->type))
+  const uint8_t type = reliq_chnode_type(chnode);
+  if (!nmatcher_match_type(type,nodep->matches.type))
     return 0;
 
-  for (size_t i = 0; i < size; i++) {
-    switch (list[i].type) {
-      case MATCHES_TYPE_HOOK:
-        if (!match_hook(st,list[i].data.hook))
-          return 0;
+  const struct ninstr *code = nodep->code;
+  const struct ninstr *in = code+1;
+  char const *src;
+  size_t srcl;
+
+  while (1) {
+    int passed;
+    switch (in->op) {
+      case NOP_ACCEPT:
+        return 1;
+      case NOP_REJECT:
+        return 0;
+      case NOP_JUMP:
+        in = code+in->target;
+        continue;
+      case NOP_TYPE:
+        passed = nmatcher_match_type(type,in->field);
+        break;
+      case NOP_TAG:
+        passed = ptag_match(rq,chnode,in->arg.tag);
         break;
-      case MATCHES_TYPE_ATTRIB:
-        if (!pattrib_match(st->rq,st->hnode,list[i].data.attrib))
-          return 0;
+      case NOP_TOKEN:
+        passed = ptoken_match(rq,chnode,in->arg.token);
         break;
-      case MATCHES_TYPE_GROUPS:
-        if (!nmatcher_groups_match(st,list[i].data.groups))
-          return 0;
+      case NOP_ATTRIB:
+        passed = pattrib_match(rq,chnode,in->arg.attrib);
         break;
+      case NOP_RANGE_SIGNED:
+        nfield_load(rq,chnode,parent,in->field,&src,&srcl);
+        passed = (range_match(srcl,&in->arg.hook->match.range,RANGE_SIGNED) != 0)^in->arg.hook->invert;
+        break;
+      case NOP_RANGE_UNSIGNED:
+        nfield_load(rq,chnode,parent,in->field,&src,&srcl);
+        passed = (range_match(srcl,&in->arg.hook->match.range,RANGE_UNSIGNED) != 0)^in->arg.hook->invert;
+        break;
+      case NOP_PATTERN:
+        nfield_load(rq,chnode,parent,in->field,&src,&srcl);
+        passed = (reliq_regexec(&in->arg.hook->match.pattern,src,srcl) != 0)^in->arg.hook->invert;
+        break;
+      default: //NOP_EXPRS
+        passed = exprs_match(rq,memo,chnode,parent,in->arg.hook)^in->arg.hook->invert;
     }
+    if (passed) {
+      in++;
+    } else if (in->target == 0) {
+      return 0;
+    } else
+      in = code+in->target;
   }
-  return 1;
 }
 
-int
-reliq_nexec(const reliq *rq, const reliq_chnode *chnode, const reliq_chnode *parent, const reliq_npattern *nodep)
-{
-  if (nodep->flags&N_EMPTY)
-    return 1;
-
-  reliq_hnode hnode;
-  reliq_chnode_conv(rq,chnode,&hnode);
-  nmatcher_state st = {
-    .hnode = &hnode,
-    .chnode = chnode,
-    .parent = parent,
-    .rq = rq
-  };
-  return nmatcher_match(&st,&nodep->matches);
-}
@@ -26,6 +26,7 @@
 //reliq_npattern flags
 #define N_EMPTY 0x1 //ignore matching
 #define N_POSITION_ABSOLUTE 0x2
+#define N_PARENT 0x4 //matching depends on parents of input nodes
 
 //nmatchers type
 #define NM_DEFAULT 0
@@ -56,9 +57,75 @@
 #define H_MATCH_COMMENT_MAIN 0x1000
 #define H_MATCH_TEXT_MAIN 0x2000
 
+//fields of node read by hooks, hook_t.arg1 of matching hooks
+#define NF_NONE 0
+#define NF_ATTRIBUTES 1
+#define NF_INSIDES 2
+#define NF_ALL 3
+#define NF_START 4
+#define NF_NAME 5
+#define NF_END 6
+#define NF_END_STRIP 7
+#define NF_INDEX 8
+#define NF_LEVEL 9
+#define NF_LEVEL_RELATIVE 10
+#define NF_TAG_COUNT 11
+#define NF_COMMENTS_COUNT 12
+#define NF_TEXT_COUNT 13
+#define NF_ALL_COUNT 14
+#define NF_POSITION 15
+#define NF_POSITION_RELATIVE 16
+
 #define MATCHES_TYPE_HOOK 1
 #define MATCHES_TYPE_ATTRIB 2
 #define MATCHES_TYPE_GROUPS 3
+#define MATCHES_TYPE_TAG 4
+#define MATCHES_TYPE_TOKEN 5
+
+/*
+  static costs of matchers, matchers of node and groups are ordered by them
+  so that cheaper ones can reject node first
+*/
+#define NCOST_TAG 0 //comparison of atoms
+#define NCOST_RANGE 1 //hook matching integer
+#define NCOST_LITERAL 2 //comparison of strings
+#define NCOST_ATTRIB 3 //scan of attributes
+#define NCOST_REGEX 4
+#define NCOST_EXPRS 5 //execution of expression
+
+/*
+  Matchers of reliq_npattern are also compiled to code executed by
+  reliq_nexec(). Every test goes to the next instruction if it passes,
+  otherwise to .target. Groups become alternatives where failing test
+  goes to the start of the next one, and passing one jumps over the rest.
+  Code starts at 1, its first instruction is NOP_REJECT which is the
+  .target of tests failing the whole pattern.
+*/
+#define NOP_ACCEPT 0
+#define NOP_REJECT 1
+#define NOP_JUMP 2 //always goes to .target
+#define NOP_TYPE 3 //.field is NM_ type
+#define NOP_TAG 4
+#define NOP_TOKEN 5
+#define NOP_ATTRIB 6
+//these load .field (NF_) of node and compare it with hook
+#define NOP_RANGE_SIGNED 7
+#define NOP_RANGE_UNSIGNED 8
+#define NOP_PATTERN 9
+
+#define NOP_EXPRS 10
+
+struct ninstr {
+  union {
+    const struct ptag *tag;
+    const struct ptoken *token;
+    const struct pattrib *attrib;
+    const struct reliq_hook *hook;
+  } arg;
+  uint32_t target;
+  uint8_t op; //NOP_
+  uint8_t field;
+};
 
 //pattrib flags
 #define A_INVERT 0x1
@@ -69,12 +136,12 @@
 struct hook_t {
   cstr8 name;
   uint16_t flags; //H_
-  uintptr_t arg1;
-  uintptr_t arg2;
+  uintptr_t arg1; //NF_ for matching hooks, AXIS_ for access hooks, NM_ for type hooks
+  uintptr_t arg2; //flags of pattern
 };
 typedef struct hook_t hook_t;
 
-typedef struct {
+typedef struct reliq_hook {
   union {
     reliq_expr expr;
     reliq_pattern pattern;
@@ -82,6 +149,7 @@ typedef struct {
   } match;
   const hook_t *hook;
   uint8_t invert : 1;
+  uint8_t memo : 1; //H_EXPRS: result doesn't depend on parent so it can be remembered for node
 } reliq_hook;
 
 typedef struct {
@@ -94,8 +162,27 @@ struct nmatchers_node {
     reliq_hook *hook;
     struct pattrib *attrib;
     nmatchers_groups *groups;
+    struct ptag *tag;
+    struct ptoken *token;
   } data;
   uint8_t type; //MATCHES_TYPE_
+  uint8_t cost; //NCOST_
+};
+
+//tag name matched through atoms of reliq_index
+struct ptag {
+  reliq_str name;
+  uint32_t hash; //index_name_hash()
+  uint8_t tag; //tag_find()
+  bool invert : 1;
+};
+
+//word of class or id attribute matched through tokens of reliq_index
+struct ptoken {
+  reliq_str name;
+  uint32_t hash; //index_token_hash()
+  uint8_t kind; //INDEX_TOKEN_
+  bool invert : 1;
 };
 
 struct pattrib {
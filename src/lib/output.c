@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "utils.h"
 #include "output.h"
@@ -149,9 +150,9 @@ fcollector_out_end(nodes_output_state *st)
 
     sink_close(&fcol_out_last->f);
     err = format_exec(fcol_out_last->v,fcol_out_last->s,out_t,NULL,NULL,format,formatl,rq);
-    free(fcol_out_last->v);
+    mem_free(fcol_out_last->v);
 
-    free(fcol_out_last);
+    mem_free(fcol_out_last);
     flexarr_dec(outs);
 
     if (err)
@@ -167,8 +168,8 @@ fcollector_outs_free(flexarr *outs) //outs: struct fcollector_out*
   for (size_t i = 0; i < size; i++) {
     sink_close(&outsv[i]->f);
     if (outsv[i]->s)
-      free(outsv[i]->v);
-    free(outsv[i]);
+      mem_free(outsv[i]->v);
+    mem_free(outsv[i]);
   }
   flexarr_free(outs);
 }
@@ -252,7 +253,7 @@ ncollector_end(nodes_output_state *st)
   const struct ncollector *ncol = st->ncols+st->ncols_i;
   if (ncol->e && st->out_ncol) {
     sink_close(st->out_ncol);
-    free(st->out_ncol);
+    mem_free(st->out_ncol);
     st->out_ncol = NULL;
 
     SINK *out_default = output_default(st);
@@ -260,7 +261,7 @@ ncollector_end(nodes_output_state *st)
     err = format_exec(st->ncol_ptr,st->ncol_ptrl,out_default,NULL,NULL,
       (ncol->e)->exprf,
       (ncol->e)->exprfl,st->rq);
-    free(st->ncol_ptr);
+    mem_free(st->ncol_ptr);
     if (err)
       goto END;
   }
@@ -283,7 +284,7 @@ outfields_inc(enum outfieldCode code, uint16_t lvl, reliq_field const *fieldname
 {
   struct outfield *field,
       **field_pre = flexarr_inc(outfields);
-  field = *field_pre = malloc(sizeof(struct outfield));
+  field = *field_pre = mem_alloc(sizeof(struct outfield));
 
   *field = (struct outfield){
     .lvl = lvl,
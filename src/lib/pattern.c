@@ -22,6 +22,7 @@
 #include <string.h>
 #include <regex.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "utils.h"
 #include "pattern.h"
@@ -236,7 +237,7 @@ reliq_regfree(reliq_pattern *pattern)
 
   if ((pattern->flags&RELIQ_PATTERN_TYPE) == RELIQ_PATTERN_TYPE_STR) {
     if (pattern->match.str.b)
-      free(pattern->match.str.b);
+      mem_free(pattern->match.str.b);
   } else
     regfree(&pattern->match.reg);
 }
@@ -277,7 +278,7 @@ reliq_regcomp(reliq_pattern *pattern, const char *src, size_t *pos, const size_t
     goto END;
 
   err = regcomp_add_pattern(pattern,str,strl,checkstrclass);
-  free(str);
+  mem_free(str);
   END: ;
   *pos = i;
   if (err)
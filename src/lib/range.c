@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "utils.h"
 #include "range.h"
@@ -266,7 +267,7 @@ range_free(reliq_range *range)
   if (!range)
     return;
   if (range->s)
-    free(range->b);
+    mem_free(range->b);
 }
 
 uint32_t
@@ -0,0 +1,399 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "../ext.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "ctype.h"
+#include "utils.h"
+#include "tags.h"
+#include "html.h"
+
+#define RECORDS_READ (1<<16)
+
+#define TOKEN_OTHER 0
+#define TOKEN_START 1
+#define TOKEN_END 2
+
+struct record_elem {
+  size_t name; //offset of name in records.names
+  uint32_t namel;
+  uint8_t tag; //TAG_ from tags.h
+};
+
+struct records {
+  FILE *input;
+  char *buf;
+  size_t bufl; //length of data in .buf
+  size_t allocated;
+
+  //names are copied since .buf gets moved by records_fill()
+  flexarr elems; //struct record_elem, elements left open by html parser
+  flexarr names; //char
+  size_t record; //index+1 in .elems of element being the current record, 0 if there's none
+};
+
+/*
+  Moves data starting at keep to the beginning of buffer and appends
+  the next part of input. Returns 0 at the end of input.
+*/
+static bool
+records_fill(struct records *r, const size_t keep)
+{
+  if (keep) {
+    r->bufl -= keep;
+    memmove(r->buf,r->buf+keep,r->bufl);
+  }
+
+  if (r->bufl+RECORDS_READ > r->allocated) {
+    size_t allocated = r->allocated ? r->allocated : RECORDS_READ;
+    while (allocated < r->bufl+RECORDS_READ)
+      allocated <<= 1;
+    r->buf = mem_realloc(r->buf,allocated);
+    r->allocated = allocated;
+  }
+
+  const size_t readbytes = fread(r->buf+r->bufl,1,RECORDS_READ,r->input);
+  r->bufl += readbytes;
+  return (readbytes != 0);
+}
+
+//returns position after '>' ending tag, skips quoted values, or 0 if buffer ends before it
+static size_t
+tag_end(const char *f, size_t i, const size_t s)
+{
+  for (; i < s; i++) {
+    if (f[i] == '>')
+      return i+1;
+    if (f[i] != '=')
+      continue;
+
+    i++;
+    while_is(isspace,f,i,s);
+    if (i >= s)
+      return 0;
+    if (f[i] == '"' || f[i] == '\'') {
+      const char *ending = memchr(f+i+1,f[i],s-i-1);
+      if (!ending)
+        return 0;
+      i = ending-f;
+    } else
+      i--;
+  }
+  return 0;
+}
+
+static size_t
+tagname_end(const char *f, size_t i, const size_t s)
+{
+  while (i < s && f[i] != '>' && f[i] != '/' && !isspace(f[i]))
+    i++;
+  return (i < s) ? i : 0;
+}
+
+/*
+  Reads markup starting with '<' at i. Sets *end to the position after it,
+  type to TOKEN_ and name of tag for starting and ending tags. Returns 0
+  if buffer ends before markup can be recognized.
+*/
+static bool
+token_handle(const char *f, const size_t i, const size_t s, uint8_t *type, reliq_cstr *name, size_t *end)
+{
+  size_t j = i+1;
+  while_is(isspace,f,j,s);
+  if (j >= s)
+    return 0;
+
+  *type = TOKEN_OTHER;
+  if (f[j] == '!') {
+    if (j+2 >= s)
+      return 0;
+    const char *ending;
+    if (f[j+1] == '-' && f[j+2] == '-') {
+      ending = memmem(f+j+3,s-j-3,"-->",3);
+      if (!ending)
+        return 0;
+      *end = ending-f+3;
+    } else {
+      ending = memchr(f+j,'>',s-j);
+      if (!ending)
+        return 0;
+      *end = ending-f+1;
+    }
+    return 1;
+  }
+
+  if (f[j] == '/') {
+    *type = TOKEN_END;
+    j++;
+    while_is(isspace,f,j,s);
+    if (j >= s)
+      return 0;
+  } else
+    *type = TOKEN_START;
+
+  if (!isalpha(f[j])) {
+    *type = TOKEN_OTHER;
+    *end = i+1;
+    return 1;
+  }
+
+  const size_t nameend = tagname_end(f,j+1,s);
+  if (!nameend)
+    return 0;
+  *name = (reliq_cstr){ .b = f+j, .s = nameend-j };
+  return ((*end = tag_end(f,nameend,s)) != 0);
+}
+
+//finds ending tag of element with raw insides, returns 0 if buffer ends before it
+static size_t
+raw_end(const char *f, size_t i, const size_t s, const reliq_cstr *name)
+{
+  while (1) {
+    const char *lt = memchr(f+i,'<',s-i);
+    if (!lt)
+      return 0;
+    i = lt-f;
+
+    size_t j = i+1;
+    while_is(isspace,f,j,s);
+    if (j >= s)
+      return 0;
+    if (f[j] == '/') {
+      j++;
+      while_is(isspace,f,j,s);
+      if (j+name->s >= s)
+        return 0;
+      if (memcasecmp(f+j,name->b,name->s) == 0) {
+        const char c = f[j+name->s];
+        if (c == '>' || c == '/' || isspace(c))
+          return i;
+      }
+    }
+    i++;
+  }
+}
+
+//returns 1 if starting tag ends with '/', making the element empty just like in attribs_handle() from html.c
+static bool
+tag_ended(const char *f, size_t i, const size_t end)
+{
+  bool ended = 0;
+  const size_t s = end-1; //position of '>'
+  while (i < s) {
+    if (isspace(f[i])) {
+      i++;
+      continue;
+    }
+    ended = (f[i] == '/');
+    if (f[i++] != '=')
+      continue;
+
+    while_is(isspace,f,i,s);
+    if (i < s && (f[i] == '"' || f[i] == '\'')) {
+      const char *ending = memchr(f+i+1,f[i],s-i-1);
+      if (!ending)
+        return 0;
+      i = ending-f+1;
+    } else
+      while (i < s && !isspace(f[i]))
+        i++;
+  }
+  return ended;
+}
+
+static void
+elem_open(struct records *r, const reliq_cstr *name, const uint8_t tag)
+{
+  struct record_elem *e = flexarr_inc(&r->elems);
+  e->name = r->names.size;
+  e->namel = name->s;
+  e->tag = tag;
+  flexarr_append(&r->names,name->b,name->s);
+}
+
+//closes elements above count first ones, returns 1 if the current record got closed
+static bool
+elems_close(struct records *r, const size_t count)
+{
+  r->names.size = ((struct record_elem*)r->elems.v)[count].name;
+  r->elems.size = count;
+  if (r->record <= count)
+    return 0;
+  r->record = 0;
+  return 1;
+}
+
+//returns number of elements that stay open after opening of tag
+static size_t
+elems_autoclosed(const struct records *r, const uint8_t tag)
+{
+  const struct record_elem *elems = (struct record_elem*)r->elems.v;
+  size_t i = r->elems.size;
+  while (i && html_tag_autocloses(elems[i-1].tag,tag))
+    i--;
+  return i;
+}
+
+/*
+  Returns number of elements that stay open after ending tag named name,
+  or -1 if html parser would ignore it. Just like in handle_ending() from
+  html.c ending tag can close ancestors but not escape from inescapable
+  element.
+*/
+static size_t
+elems_ended(const struct records *r, const reliq_cstr *name)
+{
+  const struct record_elem *elems = (struct record_elem*)r->elems.v;
+  const char *names = (char*)r->names.v;
+  size_t i = r->elems.size;
+  if (!i)
+    return -1;
+
+  const struct record_elem *e = elems+i-1;
+  if (memcaseeq(names+e->name,name->b,e->namel,name->s))
+    return i-1;
+  if (i == 1 || html_tag_flags(e->tag)&TAGF_INESCAPABLE)
+    return -1;
+
+  while (--i) {
+    e = elems+i-1;
+    if (memcaseeq(names+e->name,name->b,e->namel,name->s))
+      return i-1;
+    if (html_tag_flags(e->tag)&TAGF_INESCAPABLE)
+      break;
+  }
+  return -1;
+}
+
+static reliq_error *
+record_exec(reliq_parser *parser, const char *data, const size_t size, const reliq_expr *expr, const char *url, const size_t urll, FILE *output)
+{
+  reliq rq;
+  reliq_error *err = reliq_init_ctx(parser,data,size,&rq);
+  if (err)
+    return err;
+  if (url)
+    reliq_set_url(&rq,url,urll);
+  err = reliq_exec_file(&rq,NULL,0,expr,output);
+  reliq_free(&rq);
+  return err;
+}
+
+reliq_error *
+reliq_exec_records(FILE *input, const char *name, const size_t namel, const reliq_expr *expr, const char *url, const size_t urll, FILE *output)
+{
+  if (!namel)
+    return reliq_set_error(RELIQ_ERROR_SCRIPT,"records: empty tag name");
+
+  struct records r = {
+    .input = input,
+    .elems = flexarr_init(sizeof(struct record_elem),-(1<<6)),
+    .names = flexarr_init(sizeof(char),-(1<<10))
+  };
+  reliq_parser *parser = reliq_parser_new();
+  reliq_parser_skip(parser,reliq_expr_skip(expr));
+  reliq_error *err = NULL;
+  size_t pos = 0;
+  size_t start = 0; //start of the current record
+
+  while (1) {
+    uint8_t type;
+    reliq_cstr tagname;
+    size_t end;
+
+    const char *lt = (pos < r.bufl) ? memchr(r.buf+pos,'<',r.bufl-pos) : NULL;
+    if (!lt) {
+      pos = r.bufl;
+      goto FILL;
+    }
+    pos = lt-r.buf;
+
+    if (!token_handle(r.buf,pos,r.bufl,&type,&tagname,&end))
+      goto FILL;
+    if (type == TOKEN_OTHER) {
+      pos = end;
+      continue;
+    }
+
+    const uint8_t tag = tag_find(tagname.b,tagname.s);
+    const uint8_t flags = html_tag_flags(tag);
+    const bool isrecord = memcaseeq(tagname.b,name,tagname.s,namel);
+    size_t tagend = end;
+
+    if (type == TOKEN_START && flags&TAGF_SCRIPT) {
+      const size_t e = raw_end(r.buf,end,r.bufl,&tagname);
+      if (!e)
+        goto FILL;
+      end = e;
+    }
+
+    if (type == TOKEN_START) {
+      //elements closed by opening of this one end right before it
+      const size_t open = elems_autoclosed(&r,tag);
+      if (open < r.elems.size && elems_close(&r,open)
+        && (err = record_exec(parser,r.buf+start,pos-start,expr,url,urll,output)))
+        break;
+
+      if (flags&TAGF_SELFCLOSING || tag_ended(r.buf,tagname.b-r.buf+tagname.s,tagend)) {
+        if (isrecord && !r.record
+          && (err = record_exec(parser,r.buf+pos,tagend-pos,expr,url,urll,output)))
+          break;
+      } else {
+        elem_open(&r,&tagname,tag);
+        if (isrecord && !r.record) {
+          start = pos;
+          r.record = r.elems.size;
+        }
+      }
+    } else {
+      const size_t open = elems_ended(&r,&tagname);
+      if (open != (size_t)-1) {
+        //elements above the ended one end right before the ending tag
+        const size_t recordend = (r.record > open+1) ? pos : end;
+        if (elems_close(&r,open)
+          && (err = record_exec(parser,r.buf+start,recordend-start,expr,url,urll,output)))
+          break;
+      }
+    }
+    pos = end;
+    continue;
+
+    FILL: ;
+    //outside of records only the unfinished markup has to be kept
+    const size_t keep = r.record ? start : pos;
+    pos -= keep;
+    start -= (r.record) ? keep : 0;
+    if (!records_fill(&r,keep)) {
+      if (r.record)
+        err = record_exec(parser,r.buf+start,r.bufl-start,expr,url,urll,output);
+      break;
+    }
+  }
+
+  if (!err && ferror(input))
+    err = reliq_set_error(RELIQ_ERROR_SYS,"records: could not read input");
+  reliq_parser_free(parser);
+  flexarr_free(&r.elems);
+  flexarr_free(&r.names);
+  mem_free(r.buf);
+  return err;
+}
@@ -22,15 +22,28 @@
 #include <string.h>
 #include <stdarg.h>
 
+#include "alloc.h"
 #include "sink.h"
 #include "utils.h"
 #include "html.h"
+#include "index.h"
 #include "npattern.h"
 #include "output.h"
 
 #define FROM_COMPRESSED_NODES_INC -(1<<10)
 #define FROM_COMPRESSED_ATTRIBS_INC -(1<<10)
 
+struct reliq_parser {
+  struct html_buffers buffers;
+  size_t nodes_peak; //the most nodes that document needed in the current trim interval
+  size_t attribs_peak;
+  size_t atoms_peak;
+  uint32_t documents; //number of documents parsed in the current trim interval
+  const reliq_allocator *allocator;
+  uint8_t skip; //RELIQ_SKIP_
+  bool used : 1; //nodes and attribs are used by reliq
+};
+
 const uint8_t reliq_chnode_sz = sizeof(reliq_chnode);
 const uint8_t reliq_cattrib_sz = sizeof(reliq_cattrib);
 
@@ -39,31 +52,50 @@ reliq_set_error(const int code, const char *fmt, ...)
 {
   va_list ap;
   va_start(ap,fmt);
-  reliq_error *err = malloc(sizeof(reliq_error));
+  reliq_error *err = mem_alloc(sizeof(reliq_error));
   vsnprintf(err->msg,RELIQ_ERROR_MESSAGE_LENGTH,fmt,ap);
   err->code = code;
   va_end(ap);
   return err;
 }
 
+//same as reliq_std_free() for data allocated by library
+static int
+data_free(void *addr, size_t UNUSED len)
+{
+  mem_free(addr);
+  return 0;
+}
+
 int
 reliq_free(reliq *rq)
 {
   if (rq == NULL)
     return -1;
 
-  if (rq->nodesl)
-    free(rq->nodes);
+  const reliq_allocator *prev = reliq_get_allocator();
+  reliq_set_allocator(rq->allocator);
 
-  if (rq->attribsl)
-    free(rq->attribs);
+  if (rq->parser) {
+    rq->parser->used = 0;
+  } else if (!rq->mapped) {
+    if (rq->nodesl)
+      mem_free(rq->nodes);
 
-  if (rq->freedata)
-    return (*rq->freedata)((void*)rq->data,rq->datal);
+    if (rq->attribsl)
+      mem_free(rq->attribs);
+  }
 
-  reliq_url_free(&rq->url);
+  index_free(rq->index);
 
-  return 0;
+  int ret = 0;
+  if (rq->freedata) {
+    ret = (*rq->freedata)((void*)rq->data,rq->datal);
+  } else
+    reliq_url_free(&rq->url);
+
+  reliq_set_allocator(prev);
+  return ret;
 }
 
 void
@@ -75,7 +107,7 @@ reliq_set_url(reliq *rq, const char *url, const size_t urll)
 static void
 reliq_chnode_shift(reliq_cattrib *attribs, reliq_chnode *node, const size_t pos, const uint32_t attribsl)
 {
-  uint32_t prev = node->all;
+  reliq_off prev = node->all;
   node->all = pos;
 
   for (size_t i = 0; i < attribsl; i++)
@@ -140,7 +172,7 @@ convert_from_compressed(const reliq_compressed *compressed, const size_t compres
 
   if (independent) {
     ret.url = reliq_url_dup(&rq->url);
-    ret.freedata = reliq_std_free;
+    ret.freedata = data_free;
     sink_close(&out);
     ret.data = ptr;
     ret.datal = size;
@@ -150,6 +182,11 @@ convert_from_compressed(const reliq_compressed *compressed, const size_t compres
     ret.data = rq->data;
     ret.datal = rq->datal;
   }
+  ret.parser = NULL;
+  ret.mapped = 0;
+  ret.skipped = rq->skipped;
+  ret.allocator = reliq_get_allocator();
+  ret.index = index_create(&ret);
   return ret;
 }
 
@@ -172,17 +209,141 @@ reliq_std_free(void *addr, size_t UNUSED len)
   return 0;
 }
 
+
 reliq_error *
-reliq_init(const char *data, const size_t size, reliq *rq)
+reliq_init_skip(const char *data, const size_t size, const uint8_t skip, reliq *rq)
 {
   rq->data = data;
   rq->datal = size;
   rq->freedata = NULL;
+  rq->parser = NULL;
+  rq->mapped = 0;
+  rq->skipped = skip;
+  rq->allocator = reliq_get_allocator();
   rq->url = (reliq_url){0};
 
-  reliq_error *err = html_handle(data,size,&rq->nodes,&rq->nodesl,&rq->attribs,&rq->attribsl);
+  reliq_error *err = html_handle(data,size,skip,&rq->nodes,&rq->nodesl,&rq->attribs,&rq->attribsl,&rq->index);
 
   if (err)
     reliq_free(rq);
   return err;
 }
+
+reliq_error *
+reliq_init(const char *data, const size_t size, reliq *rq)
+{
+  return reliq_init_skip(data,size,0,rq);
+}
+
+reliq_error *
+reliq_init_for(const char *data, const size_t size, const reliq_expr *expr, reliq *rq)
+{
+  return reliq_init_skip(data,size,reliq_expr_skip(expr),rq);
+}
+
+reliq_parser *
+reliq_parser_new(void)
+{
+  reliq_parser *parser = mem_calloc(1,sizeof(reliq_parser));
+  html_buffers_init(&parser->buffers);
+  parser->allocator = reliq_get_allocator();
+  return parser;
+}
+
+void
+reliq_parser_free(reliq_parser *parser)
+{
+  if (!parser)
+    return;
+  const reliq_allocator *prev = reliq_get_allocator();
+  reliq_set_allocator(parser->allocator);
+  html_buffers_free(&parser->buffers);
+  mem_free(parser);
+  reliq_set_allocator(prev);
+}
+
+void
+reliq_parser_skip(reliq_parser *parser, const uint8_t skip)
+{
+  parser->skip = skip;
+}
+
+static void
+parser_buffer_trim(flexarr *buffer, const size_t peak)
+{
+  if (buffer->asize/2 <= peak)
+    return;
+  buffer->size = 0;
+  if (!peak) {
+    flexarr_free(buffer);
+    return;
+  }
+  buffer->v = mem_realloc(buffer->v,peak*buffer->elsize);
+  buffer->asize = peak;
+}
+
+static void
+parser_trim(reliq_parser *parser)
+{
+  if (parser->documents < RELIQ_PARSER_TRIM_INTERVAL)
+    return;
+
+  struct html_buffers *b = &parser->buffers;
+  parser_buffer_trim(&b->nodes,parser->nodes_peak);
+  parser_buffer_trim(&b->attribs,parser->attribs_peak);
+  parser_buffer_trim(&b->atoms,parser->atoms_peak);
+
+  parser->nodes_peak = 0;
+  parser->attribs_peak = 0;
+  parser->atoms_peak = 0;
+  parser->documents = 0;
+}
+
+reliq_error *
+reliq_init_ctx(reliq_parser *parser, const char *data, const size_t size, reliq *rq)
+{
+  if (parser->used)
+    return reliq_init_skip(data,size,parser->skip,rq);
+
+  const reliq_allocator *prev = reliq_get_allocator();
+  reliq_set_allocator(parser->allocator);
+  parser_trim(parser);
+
+  rq->data = data;
+  rq->datal = size;
+  rq->freedata = NULL;
+  rq->parser = NULL;
+  rq->mapped = 0;
+  rq->skipped = parser->skip;
+  rq->allocator = parser->allocator;
+  rq->url = (reliq_url){0};
+
+  struct html_buffers *b = &parser->buffers;
+  reliq_error *err = html_handle_buffers(data,size,parser->skip,b,&rq->index);
+  if (err) {
+    rq->nodes = NULL;
+    rq->nodesl = 0;
+    rq->attribs = NULL;
+    rq->attribsl = 0;
+    reliq_free(rq);
+    goto END;
+  }
+
+  rq->nodes = (reliq_chnode*)b->nodes.v;
+  rq->nodesl = b->nodes.size;
+  rq->attribs = (reliq_cattrib*)b->attribs.v;
+  rq->attribsl = b->attribs.size;
+  rq->parser = parser;
+  parser->used = 1;
+
+  #define PEAK(x,y) if (x < y) x = y
+  PEAK(parser->nodes_peak,b->nodes.size);
+  PEAK(parser->attribs_peak,b->attribs.size);
+  PEAK(parser->atoms_peak,b->atoms.size);
+  #undef PEAK
+  parser->documents++;
+
+  END: ;
+  reliq_set_allocator(prev);
+  return err;
+}
@@ -31,12 +31,12 @@ extern "C" {
 
 //#RELIQ_COMPILE_FLAGS
 
+#define RELIQ_MAX_NODE_LEVEL UINT16_MAX //limited by reliq_chnode.lvl, html parser doesn't use stack for nesting
+
 #ifdef RELIQ_SMALL_STACK
-#define RELIQ_MAX_NODE_LEVEL 256
 #define RELIQ_MAX_GROUP_LEVEL 256
 #define RELIQ_MAX_BLOCK_LEVEL 256
 #else
-#define RELIQ_MAX_NODE_LEVEL 8192 //stack overflows at 21828 at 8192kb stack
 #define RELIQ_MAX_GROUP_LEVEL 3552 //stack overflows at 20149 at 8192kb stack
 #define RELIQ_MAX_BLOCK_LEVEL 6892 //stack overflows at 18066 at 8192kb stack
 #endif
@@ -49,6 +49,21 @@ extern "C" {
 #define RELIQ_HTML_OTHERSIZE(x,y) : y
 #endif
 
+/*
+    Offsets of reliq.data stored in reliq_chnode and reliq_cattrib, they
+    limit size of document to 4GiB unless RELIQ_HTML_HUGE is defined.
+    Number of nodes and attribs is limited by UINT32_MAX either way.
+*/
+#ifdef RELIQ_HTML_HUGE
+typedef uint64_t reliq_off;
+#define RELIQ_DATA_MAX UINT64_MAX
+#define RELIQ_HTML_COUNTSIZE(x)
+#else
+typedef uint32_t reliq_off;
+#define RELIQ_DATA_MAX UINT32_MAX
+#define RELIQ_HTML_COUNTSIZE(x) : x
+#endif
+
 #define RELIQ_ERROR_MESSAGE_LENGTH 512
 
 #define RELIQ_ERROR_SYS 5
@@ -60,6 +75,61 @@ typedef struct {
   int code; //RELIQ_ERROR_
 } reliq_error;
 
+/*
+    Functions through which the library allocates memory, .user is passed
+    to all of them. .realloc() and .free() get pointers returned by any
+    of them, .realloc() gets NULL if memory is allocated for the first time.
+*/
+typedef struct {
+  void *(*alloc)(void *user, size_t size);
+  void *(*realloc)(void *user, void *ptr, size_t size);
+  void (*free)(void *user, void *ptr);
+  void *user;
+} reliq_allocator;
+
+/*
+    Sets allocator used by the library in the calling thread, NULL restores
+    malloc(3). Allocator is set for everything that's called after it, so
+    different ones can be used for parsing, compiling and executing.
+
+    reliq, reliq_expr and reliq_parser keep allocator that was set when they
+    were created and free themselves with it. Lookup tables that reliq
+    creates on first use while it's executed are also allocated with its
+    allocator. Everything else made by the library (reliq_error, output of
+    reliq_exec_str(), reliq_compressed, reliq_url) has to be freed with
+    allocator that made it.
+
+    Documents are parsed in a single thread while allocator is set, because
+    it doesn't have to be thread safe. Regular expressions are compiled by
+    libc which allocates them with malloc(3) anyway.
+*/
+void reliq_set_allocator(const reliq_allocator *allocator);
+const reliq_allocator *reliq_get_allocator(void);
+
+/*
+    Allocator that takes memory from big blocks and frees all of it at
+    once e.g.
+
+      reliq_arena *arena = reliq_arena_new(0);
+      reliq_allocator allocator = reliq_arena_allocator(arena);
+      reliq_set_allocator(&allocator);
+      ...parse document, execute expression, write output...
+      reliq_set_allocator(NULL);
+      reliq_arena_reset(arena);
+
+    Freeing the latest allocation gives its space back, other frees do
+    nothing. The latest allocation is also resized in place if possible.
+    reliq_arena_reset() frees everything allocated since the arena was
+    created or last reset, keeping the first block for reuse. Objects
+    allocated from it mustn't be used or freed after that.
+*/
+typedef struct reliq_arena reliq_arena;
+
+reliq_arena *reliq_arena_new(const size_t blocksize); //blocksize can be 0
+reliq_allocator reliq_arena_allocator(reliq_arena *arena);
+void reliq_arena_reset(reliq_arena *arena);
+void reliq_arena_free(reliq_arena *arena);
+
 typedef struct {
   char *b;
   size_t s;
@@ -72,7 +142,7 @@ typedef struct {
 
 #pragma pack(push,1)
 typedef struct {
-  uint32_t key; //key+hnode.all.b
+  reliq_off key; //offset of key in reliq.data
   uint32_t valuel RELIQ_HTML_OTHERSIZE(24,16);
   uint32_t value RELIQ_HTML_OTHERSIZE(8,8); // value+key+keyl
   uint32_t keyl RELIQ_HTML_OTHERSIZE(8,8);
@@ -96,9 +166,9 @@ typedef struct {
     +rq->endtag
 */
 typedef struct {
-  uint32_t all;
-  uint32_t all_len; //length of all
-  uint32_t endtag; //endtag+tag+tagl+all
+  reliq_off all;
+  reliq_off all_len; //length of all
+  reliq_off endtag; //endtag+tag+tagl+all
   uint32_t attribs;
   uint16_t lvl;
 
@@ -107,9 +177,9 @@ typedef struct {
   uint32_t tagl RELIQ_HTML_OTHERSIZE(16,8);
 
   uint32_t tag RELIQ_HTML_OTHERSIZE(8,8); //tag+all
-  uint32_t tag_count : 30;
-  uint32_t text_count : 30;
-  uint32_t comment_count : 28;
+  uint32_t tag_count RELIQ_HTML_COUNTSIZE(30);
+  uint32_t text_count RELIQ_HTML_COUNTSIZE(30);
+  uint32_t comment_count RELIQ_HTML_COUNTSIZE(28);
 } reliq_chnode;
 #pragma pack(pop)
 extern const uint8_t reliq_chnode_sz; //sizeof(reliq_chnode)
@@ -148,6 +218,7 @@ typedef struct {
 
 //anonymous declaration
 typedef struct reliq_expr reliq_expr;
+typedef struct reliq_index reliq_index;
 
 typedef struct {
   reliq_str url;
@@ -182,6 +253,8 @@ reliq_url reliq_url_dup(const reliq_url *url);
 
 void reliq_url_free(reliq_url *url);
 
+typedef struct reliq_parser reliq_parser;
+
 //if reliq.freedata is set then it will be called with reliq_free() to free reliq.data
 typedef struct {
   reliq_url url;
@@ -194,13 +267,81 @@ typedef struct {
   size_t datal; //length of data
   size_t nodesl;
   size_t attribsl;
+
+  //new fields are added at the end so that offsets of older ones stay the same
+  reliq_index *index; //lookup tables of document, can be NULL
+  reliq_parser *parser; //if set .nodes and .attribs belong to it
+  const reliq_allocator *allocator; //allocator used for reliq_free()
+  bool mapped; //.nodes and .attribs are part of file loaded by reliq_load_mmap()
+  uint8_t skipped; //RELIQ_SKIP_ of nodes left out by parser
 } reliq;
 
 int reliq_std_free(void *addr, size_t len); //mapping to free(3) that can be used for reliq.freedata
 
 reliq_error *reliq_init(const char *data, const size_t size, reliq *rq);
+
+#define RELIQ_SKIP_TEXT_EMPTY 0x1 //text nodes with only whitespace (RELIQ_HNODE_TYPE_TEXT_EMPTY)
+#define RELIQ_SKIP_COMMENTS 0x2 //nodes of RELIQ_HNODE_TYPE_COMMENT, including <!DOCTYPE>
+#define RELIQ_SKIP_TEXT 0x4 //all text nodes, including insides of script and style
+
+/*
+    Same as reliq_init() but nodes of kinds in skip (RELIQ_SKIP_) are left
+    out of reliq.nodes and aren't counted as descendants of other nodes.
+    Remaining nodes are the same as without skipping, insides of elements
+    still contain skipped nodes.
+*/
+reliq_error *reliq_init_skip(const char *data, const size_t size, const uint8_t skip, reliq *rq);
+
+/*
+    Same as reliq_init_skip() with skip set to reliq_expr_skip(expr), document
+    parsed this way should be used only with expr as results of other
+    expressions may differ.
+*/
+reliq_error *reliq_init_for(const char *data, const size_t size, const reliq_expr *expr, reliq *rq);
 int reliq_free(reliq *rq); //returns result of .freedata() otherwise 0
 
+/*
+    Keeps buffers used for parsing between documents, so that parsing many
+    of them one after another doesn't allocate them every time e.g.
+
+      reliq_parser *parser = reliq_parser_new();
+      for (...) {
+        reliq_error *err = reliq_init_ctx(parser,data,size,&rq);
+        ...
+        reliq_free(&rq);
+      }
+      reliq_parser_free(parser);
+
+    reliq created by reliq_init_ctx() uses nodes and attribs of parser until
+    reliq_free(), so parser has to outlive it. If they're still used when
+    the next document is parsed, it gets its own like with reliq_init().
+
+    Every RELIQ_PARSER_TRIM_INTERVAL documents buffers that are more than
+    twice as big as the most that any of these documents needed are shrunk
+    to that size, so that a single big document doesn't hold memory forever.
+*/
+#define RELIQ_PARSER_TRIM_INTERVAL 64
+
+reliq_parser *reliq_parser_new(void);
+void reliq_parser_free(reliq_parser *parser);
+void reliq_parser_skip(reliq_parser *parser, const uint8_t skip); //documents will be parsed like by reliq_init_skip()
+reliq_error *reliq_init_ctx(reliq_parser *parser, const char *data, const size_t size, reliq *rq);
+
+/*
+    Saves parsed document with its data to file at path, so that it can
+    be loaded without parsing by reliq_load_mmap(). File can be loaded only
+    by reliq built with the same RELIQ_HTML_SIZE on the same architecture.
+*/
+reliq_error *reliq_save(const reliq *rq, const char *path);
+
+/*
+    Maps file made by reliq_save() read-only. Returned reliq points into
+    mapping which is unmapped by its .freedata in reliq_free(). Offsets of
+    nodes and attribs are checked to lie within file, otherwise
+    RELIQ_ERROR_HTML is returned.
+*/
+reliq_error *reliq_load_mmap(const char *path, reliq *rq);
+
 //sets reliq.url, which automatically gets freed by reliq_free()
 //if reliq.url was already set, it will be reused so reliq.url
 //  doesn't have to be deallocated before calling this function
@@ -208,7 +349,7 @@ void reliq_set_url(reliq *rq, const char *url, const size_t urll);
 
 //these work as partial reliq_chnode_conv()
 uint32_t reliq_chnode_attribsl(const reliq *rq, const reliq_chnode *hnode);
-uint32_t reliq_chnode_insides(const reliq *rq, const reliq_chnode *hnode, const uint8_t type);
+reliq_off reliq_chnode_insides(const reliq *rq, const reliq_chnode *hnode, const uint8_t type);
 uint8_t reliq_chnode_type(const reliq_chnode *c);
 const char *reliq_hnode_starttag(const reliq_hnode *hn, size_t *len);
 const char *reliq_hnode_endtag(const reliq_hnode *hn, size_t *len);
@@ -224,13 +365,47 @@ reliq reliq_from_compressed_independent(const reliq_compressed *compressed, cons
 
 reliq_error *reliq_ecomp(const char *script, const size_t size, reliq_expr **expr);
 
-//input and inputl can be set to NULL and 0 if unused
+/*
+    input and inputl can be set to NULL and 0 if unused. The same reliq can
+    be executed by multiple threads at once if allocator it was created
+    with is thread safe.
+*/
 reliq_error *reliq_exec_file(const reliq *rq, const reliq_compressed *input, const size_t inputl, const reliq_expr *expr, FILE *output);
 reliq_error *reliq_exec_str(const reliq *rq, const reliq_compressed *input, const size_t inputl, const reliq_expr *expr, char **str, size_t *strl);
 reliq_error *reliq_exec(const reliq *rq, const reliq_compressed *input, const size_t inputl, const reliq_expr *expr, reliq_compressed **nodes, size_t *nodesl);
 
+/*
+    Executes each of exprs on the whole document like reliq_exec_str(),
+    writing output of exprs[i] to strs[i] and strsl[i]. Nodes are scanned
+    once for the first node patterns of all exprs instead of once per expr.
+    Elements of exprs can be NULL. On error, outputs of exprs following the
+    failed one are left NULL, strs have to be freed in either case.
+*/
+reliq_error *reliq_exec_multi(const reliq *rq, const reliq_expr *const *exprs, const size_t exprsl, char **strs, size_t *strsl);
+
+/*
+    Runs expr on every element named name (without case distinction) found
+    in input, each of them parsed as a separate document. Only the current
+    element is kept in memory so input can be larger than it.
+
+    Elements end where the html parser would close them, so omitted ending
+    tags (e.g. of li, p or td) are handled, nested elements with the same
+    name are part of the outer one. Comments and insides of script and
+    style are skipped while searching. Elements are parsed like by
+    reliq_init_for(). url can be set to NULL.
+*/
+reliq_error *reliq_exec_records(FILE *input, const char *name, const size_t namel, const reliq_expr *expr, const char *url, const size_t urll, FILE *output);
+
 void reliq_efree(reliq_expr *expr);
 
+/*
+    Returns RELIQ_SKIP_ of nodes that expr can never match nor depend on in
+    any way (through hooks like counttext@ or position@ and format
+    specifiers like %t, %C or %P), so that results of expr are the same for
+    documents parsed with them skipped.
+*/
+uint8_t reliq_expr_skip(const reliq_expr *expr);
+
 
 #define RELIQ_FIELD_TYPE_ARG_STR 0
 #define RELIQ_FIELD_TYPE_ARG_UNSIGNED 1
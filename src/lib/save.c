@@ -0,0 +1,291 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "../ext.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if !defined(__MINGW32__) && !defined(__MINGW64__)
+#include <sys/mman.h>
+#endif
+
+#include "alloc.h"
+#include "index.h"
+
+/*
+    Saved document consists of header, data, nodes and attribs, each of
+    the last two starting at SAVE_ALIGN. Fields are written in native
+    byte order and sizes, file can be loaded only by reliq built with the
+    same RELIQ_HTML_SIZE and RELIQ_HTML_HUGE on machine with the same byte
+    order.
+*/
+
+#define SAVE_MAGIC "RELIQDOC"
+#define SAVE_VERSION 1
+#define SAVE_ENDIAN 0x01020304
+#define SAVE_ALIGN 8
+#define SAVE_PADDING_MAX SAVE_ALIGN
+
+struct save_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian; //SAVE_ENDIAN
+  uint8_t html_size; //RELIQ_HTML_SIZE
+  uint8_t chnode_sz;
+  uint8_t cattrib_sz;
+  uint8_t huge; //RELIQ_HTML_HUGE
+  uint8_t skipped; //reliq.skipped
+  uint8_t unused[3];
+  uint64_t size; //size of the whole file
+  uint64_t datal;
+  uint64_t nodes; //offset of nodes
+  uint64_t nodesl;
+  uint64_t attribs; //offset of attribs
+  uint64_t attribsl;
+};
+
+#define SAVE_HEADER_SIZE sizeof(struct save_header)
+
+static inline uint64_t
+save_align(const uint64_t pos)
+{
+  return (pos+SAVE_ALIGN-1)&~(uint64_t)(SAVE_ALIGN-1);
+}
+
+static bool
+save_write(FILE *f, const void *v, const size_t size, uint64_t *pos)
+{
+  const uint64_t aligned = save_align(*pos);
+  const char padding[SAVE_PADDING_MAX] = {0};
+  if (aligned != *pos && fwrite(padding,1,aligned-*pos,f) != aligned-*pos)
+    return 0;
+  *pos = aligned+size;
+  return (!size || fwrite(v,1,size,f) == size);
+}
+
+reliq_error *
+reliq_save(const reliq *rq, const char *path)
+{
+  struct save_header h = {
+    .version = SAVE_VERSION,
+    .endian = SAVE_ENDIAN,
+    .html_size = RELIQ_HTML_SIZE,
+    .chnode_sz = sizeof(reliq_chnode),
+    .cattrib_sz = sizeof(reliq_cattrib),
+    #ifdef RELIQ_HTML_HUGE
+    .huge = 1,
+    #endif
+    .skipped = rq->skipped,
+    .datal = rq->datal,
+    .nodesl = rq->nodesl,
+    .attribsl = rq->attribsl
+  };
+  memcpy(h.magic,SAVE_MAGIC,sizeof(h.magic));
+  h.nodes = save_align(SAVE_HEADER_SIZE+h.datal);
+  h.attribs = save_align(h.nodes+h.nodesl*sizeof(reliq_chnode));
+  h.size = h.attribs+h.attribsl*sizeof(reliq_cattrib);
+
+  FILE *f = fopen(path,"wb");
+  if (!f)
+    return reliq_set_error(RELIQ_ERROR_SYS,"%s: %s",path,strerror(errno));
+
+  uint64_t pos = 0;
+  bool success = save_write(f,&h,sizeof(h),&pos)
+    && save_write(f,rq->data,rq->datal,&pos)
+    && save_write(f,rq->nodes,rq->nodesl*sizeof(reliq_chnode),&pos)
+    && save_write(f,rq->attribs,rq->attribsl*sizeof(reliq_cattrib),&pos);
+  int e = errno;
+
+  if (fclose(f) != 0 && success) {
+    success = 0;
+    e = errno;
+  }
+  if (!success)
+    return reliq_set_error(RELIQ_ERROR_SYS,"%s: %s",path,strerror(e));
+  return NULL;
+}
+
+//frees whole file based on data which follows the header
+static int
+save_free(void *addr, size_t UNUSED len)
+{
+  char *base = (char*)addr-SAVE_HEADER_SIZE;
+  #if defined(__MINGW32__) || defined(__MINGW64__)
+  mem_free(base);
+  return 0;
+  #else
+  return munmap(base,((struct save_header*)base)->size);
+  #endif
+}
+
+static reliq_error *
+save_header_check(const struct save_header *h, const uint64_t size, const char *path)
+{
+  if (size < SAVE_HEADER_SIZE || memcmp(h->magic,SAVE_MAGIC,sizeof(h->magic)) != 0)
+    return reliq_set_error(RELIQ_ERROR_HTML,"%s: not a saved document",path);
+  if (h->version != SAVE_VERSION)
+    return reliq_set_error(RELIQ_ERROR_HTML,"%s: unsupported version %u of saved document",path,h->version);
+  #ifdef RELIQ_HTML_HUGE
+  if (h->huge != 1)
+  #else
+  if (h->huge != 0)
+  #endif
+    return reliq_set_error(RELIQ_ERROR_HTML,"%s: saved document %s O_HTML_HUGE",path,h->huge ? "requires" : "was made without");
+  if (h->html_size != RELIQ_HTML_SIZE)
+    return reliq_set_error(RELIQ_ERROR_HTML,"%s: saved document uses RELIQ_HTML_SIZE %u instead of %u",path,h->html_size,RELIQ_HTML_SIZE);
+  if (h->endian != SAVE_ENDIAN || h->chnode_sz != sizeof(reliq_chnode) || h->cattrib_sz != sizeof(reliq_cattrib))
+    return reliq_set_error(RELIQ_ERROR_HTML,"%s: saved document comes from different architecture",path);
+
+  if (h->size != size
+    || h->datal > size-SAVE_HEADER_SIZE
+    || h->nodes < SAVE_HEADER_SIZE+h->datal
+    || h->nodes > size || h->nodesl > (size-h->nodes)/sizeof(reliq_chnode)
+    || h->attribs < h->nodes+h->nodesl*sizeof(reliq_chnode)
+    || h->attribs > size || h->attribsl > (size-h->attribs)/sizeof(reliq_cattrib))
+    return reliq_set_error(RELIQ_ERROR_HTML,"%s: saved document is truncated",path);
+  return NULL;
+}
+
+/*
+  Checks if offsets of nodes and attribs stay within data and nodes so
+  that corrupted file can't make reliq read outside of mapping.
+*/
+static bool
+save_nodes_check(const struct save_header *h, const char *base)
+{
+  const reliq_chnode *nodes = (const reliq_chnode*)(base+h->nodes);
+  const reliq_cattrib *attribs = (const reliq_cattrib*)(base+h->attribs);
+  const uint64_t datal = h->datal,
+    nodesl = h->nodesl,
+    attribsl = h->attribsl;
+
+  for (uint64_t i = 0; i < nodesl; i++) {
+    const reliq_chnode *n = nodes+i;
+    if ((uint64_t)n->all+n->all_len > datal)
+      return 0;
+
+    const uint64_t next_attribs = (i+1 < nodesl) ? nodes[i+1].attribs : attribsl;
+    if (n->attribs > next_attribs || next_attribs > attribsl)
+      return 0;
+
+    const uint64_t desc = (uint64_t)n->tag_count+n->text_count+n->comment_count;
+    if (desc >= nodesl-i)
+      return 0;
+
+    const uint8_t type = reliq_chnode_type(n);
+    if (type == RELIQ_HNODE_TYPE_TAG) {
+      const uint64_t insides = (uint64_t)n->tag+n->tagl;
+      if (insides+n->endtag > n->all_len)
+        return 0;
+      if (desc) {
+        const uint64_t start = n->all+insides,
+          next = nodes[i+1].all;
+        if (next < start || next > start+n->endtag)
+          return 0;
+      }
+    } else if (type == RELIQ_HNODE_TYPE_COMMENT
+      && (n->tagl > n->endtag || n->endtag > n->all_len))
+      return 0;
+  }
+
+  for (uint64_t i = 0; i < attribsl; i++) {
+    const reliq_cattrib *a = attribs+i;
+    if ((uint64_t)a->key+a->keyl+a->value+a->valuel > datal)
+      return 0;
+  }
+  return 1;
+}
+
+static reliq_error *
+save_map(const char *path, char **base, uint64_t *size)
+{
+  reliq_error *err = NULL;
+  int fd = open(path,O_RDONLY);
+  if (fd == -1)
+    return reliq_set_error(RELIQ_ERROR_SYS,"%s: %s",path,strerror(errno));
+
+  struct stat st;
+  if (fstat(fd,&st) == -1) {
+    err = reliq_set_error(RELIQ_ERROR_SYS,"%s: %s",path,strerror(errno));
+    goto END;
+  }
+  *size = st.st_size;
+  if (*size < SAVE_HEADER_SIZE) {
+    err = reliq_set_error(RELIQ_ERROR_HTML,"%s: not a saved document",path);
+    goto END;
+  }
+
+  #if defined(__MINGW32__) || defined(__MINGW64__)
+  *base = mem_alloc(*size);
+  if (read(fd,*base,*size) != (ssize_t)*size) {
+    err = reliq_set_error(RELIQ_ERROR_SYS,"%s: %s",path,strerror(errno));
+    mem_free(*base);
+  }
+  #else
+  *base = mmap(NULL,*size,PROT_READ,MAP_PRIVATE,fd,0);
+  if (*base == MAP_FAILED)
+    err = reliq_set_error(RELIQ_ERROR_SYS,"%s: %s",path,strerror(errno));
+  #endif
+
+  END: ;
+  close(fd);
+  return err;
+}
+
+reliq_error *
+reliq_load_mmap(const char *path, reliq *rq)
+{
+  char *base = NULL;
+  uint64_t size = 0;
+  reliq_error *err = save_map(path,&base,&size);
+  if (err)
+    return err;
+
+  const struct save_header *h = (const struct save_header*)base;
+  err = save_header_check(h,size,path);
+  if (!err && !save_nodes_check(h,base))
+    err = reliq_set_error(RELIQ_ERROR_HTML,"%s: saved document is corrupted",path);
+  if (err) {
+    #if defined(__MINGW32__) || defined(__MINGW64__)
+    mem_free(base);
+    #else
+    munmap(base,size);
+    #endif
+    return err;
+  }
+
+  rq->url = (reliq_url){0};
+  rq->freedata = save_free;
+  rq->data = base+SAVE_HEADER_SIZE;
+  rq->datal = h->datal;
+  rq->nodes = (reliq_chnode*)(base+h->nodes);
+  rq->nodesl = h->nodesl;
+  rq->attribs = (reliq_cattrib*)(base+h->attribs);
+  rq->attribsl = h->attribsl;
+  rq->parser = NULL;
+  rq->mapped = 1;
+  rq->skipped = h->skipped;
+  rq->allocator = reliq_get_allocator();
+  rq->index = index_create(rq);
+  return NULL;
+}
@@ -0,0 +1,224 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "../ext.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ctype.h"
+#include "scan.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define SCAN_VEC 32
+typedef __m256i vec_t;
+#define vec_load(x) _mm256_loadu_si256((const __m256i*)(x))
+#define vec_set1(x) _mm256_set1_epi8(x)
+#define vec_eq(x,y) _mm256_cmpeq_epi8(x,y)
+#define vec_or(x,y) _mm256_or_si256(x,y)
+#define vec_and(x,y) _mm256_and_si256(x,y)
+#define vec_sub(x,y) _mm256_sub_epi8(x,y)
+#define vec_min(x,y) _mm256_min_epu8(x,y)
+#define vec_mask(x) ((uint32_t)_mm256_movemask_epi8(x))
+
+#elif defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#define SCAN_VEC 16
+typedef __m128i vec_t;
+#define vec_load(x) _mm_loadu_si128((const __m128i*)(x))
+#define vec_set1(x) _mm_set1_epi8(x)
+#define vec_eq(x,y) _mm_cmpeq_epi8(x,y)
+#define vec_or(x,y) _mm_or_si128(x,y)
+#define vec_and(x,y) _mm_and_si128(x,y)
+#define vec_sub(x,y) _mm_sub_epi8(x,y)
+#define vec_min(x,y) _mm_min_epu8(x,y)
+#define vec_mask(x) ((uint32_t)_mm_movemask_epi8(x))
+
+#endif
+
+#ifdef SCAN_VEC
+
+//marks '\t','\n','\v','\f','\r' and ' ', the same set as IS_SPACE
+static inline vec_t
+vec_isspace(const vec_t v)
+{
+  const vec_t t = vec_sub(v,vec_set1('\t'));
+  return vec_or(
+    vec_eq(vec_min(t,vec_set1('\r'-'\t')),t),
+    vec_eq(v,vec_set1(' '))
+  );
+}
+
+#endif
+
+size_t
+scan_lt(const char *f, const size_t pos, const size_t size)
+{
+  size_t i = pos;
+  #ifdef SCAN_VEC
+  const vec_t lt = vec_set1('<');
+  for (; i+SCAN_VEC <= size; i += SCAN_VEC) {
+    uint32_t m = vec_mask(vec_eq(vec_load(f+i),lt));
+    if (m)
+      return i+__builtin_ctz(m);
+  }
+  while (i < size && f[i] != '<')
+    i++;
+  return i;
+  #else
+  if (i >= size)
+    return size;
+  char const *r = memchr(f+i,'<',size-i);
+  return r ? (size_t)(r-f) : size;
+  #endif
+}
+
+size_t
+scan_endtag(const char *f, const size_t pos, const size_t size)
+{
+  size_t i = pos;
+  #ifdef SCAN_VEC
+  const vec_t lt = vec_set1('<'),
+    slash = vec_set1('/');
+  for (; i+SCAN_VEC < size; i += SCAN_VEC) {
+    const vec_t next = vec_load(f+i+1);
+    uint32_t m = vec_mask(vec_and(vec_eq(vec_load(f+i),lt),
+      vec_or(vec_eq(next,slash),vec_isspace(next))));
+    if (m)
+      return i+__builtin_ctz(m);
+  }
+  #endif
+  for (; i+1 < size; i++)
+    if (f[i] == '<' && (f[i+1] == '/' || isspace(f[i+1])))
+      return i;
+  return size;
+}
+
+size_t
+scan_comment_end(const char *f, const size_t pos, const size_t size)
+{
+  size_t i = pos;
+  #ifdef SCAN_VEC
+  const vec_t dash = vec_set1('-'),
+    gt = vec_set1('>');
+  for (; i+SCAN_VEC+2 <= size; i += SCAN_VEC) {
+    uint32_t m = vec_mask(vec_and(
+      vec_and(vec_eq(vec_load(f+i),dash),vec_eq(vec_load(f+i+1),dash)),
+      vec_eq(vec_load(f+i+2),gt)));
+    if (m)
+      return i+__builtin_ctz(m);
+  }
+  for (; i+2 < size; i++)
+    if (f[i] == '-' && f[i+1] == '-' && f[i+2] == '>')
+      return i;
+  return size;
+  #else
+  if (i >= size)
+    return size;
+  char const *r = memmem(f+i,size-i,"-->",3);
+  return r ? (size_t)(r-f) : size;
+  #endif
+}
+
+size_t
+scan_tagname_end(const char *f, const size_t pos, const size_t size)
+{
+  size_t i = pos;
+  #ifdef SCAN_VEC
+  const vec_t gt = vec_set1('>'),
+    slash = vec_set1('/');
+  for (; i+SCAN_VEC <= size; i += SCAN_VEC) {
+    const vec_t v = vec_load(f+i);
+    uint32_t m = vec_mask(vec_or(vec_or(vec_eq(v,gt),vec_eq(v,slash)),vec_isspace(v)));
+    if (m)
+      return i+__builtin_ctz(m);
+  }
+  #endif
+  while (i < size && !isspace(f[i]) && f[i] != '>' && f[i] != '/')
+    i++;
+  return i;
+}
+
+size_t
+scan_attribname_end(const char *f, const size_t pos, const size_t size)
+{
+  size_t i = pos;
+  #ifdef SCAN_VEC
+  const vec_t eq = vec_set1('='),
+    gt = vec_set1('>'),
+    slash = vec_set1('/');
+  for (; i+SCAN_VEC <= size; i += SCAN_VEC) {
+    const vec_t v = vec_load(f+i);
+    uint32_t m = vec_mask(vec_or(
+      vec_or(vec_eq(v,eq),vec_eq(v,gt)),
+      vec_or(vec_eq(v,slash),vec_isspace(v))));
+    if (m)
+      return i+__builtin_ctz(m);
+  }
+  #endif
+  while (i < size && f[i] != '=' && f[i] != '>' && f[i] != '/' && !isspace(f[i]))
+    i++;
+  return i;
+}
+
+size_t
+scan_nonspace(const char *f, const size_t pos, const size_t size)
+{
+  size_t i = pos;
+  #ifdef SCAN_VEC
+  for (; i+SCAN_VEC <= size; i += SCAN_VEC) {
+    uint32_t m = ~vec_mask(vec_isspace(vec_load(f+i)));
+    #if SCAN_VEC == 16
+    m &= 0xffff;
+    #endif
+    if (m)
+      return i+__builtin_ctz(m);
+  }
+  #endif
+  while (i < size && isspace(f[i]))
+    i++;
+  return i;
+}
+
+void
+scan_count_markup(const char *f, const size_t size, size_t *lt, size_t *eq)
+{
+  size_t i = 0,
+    ltc = 0,
+    eqc = 0;
+  #ifdef SCAN_VEC
+  const vec_t ltv = vec_set1('<'),
+    eqv = vec_set1('=');
+  for (; i+SCAN_VEC <= size; i += SCAN_VEC) {
+    const vec_t v = vec_load(f+i);
+    ltc += __builtin_popcount(vec_mask(vec_eq(v,ltv)));
+    eqc += __builtin_popcount(vec_mask(vec_eq(v,eqv)));
+  }
+  #endif
+  for (; i < size; i++) {
+    ltc += (f[i] == '<');
+    eqc += (f[i] == '=');
+  }
+  *lt = ltc;
+  *eq = eqc;
+}
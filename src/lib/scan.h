@@ -0,0 +1,43 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef RELIQ_SCAN_H
+#define RELIQ_SCAN_H
+
+#include <stddef.h>
+
+/*
+    Scanners used by html parser in its hot loops. They use SSE2 or AVX2
+    if compiler targets it, otherwise they fall back to scalar loops.
+
+    Each of them starts at f+pos and returns position of the first matching
+    character or size if nothing was found. Whitespace is understood the
+    same way as isspace() from ctype.h.
+*/
+
+size_t scan_lt(const char *f, const size_t pos, const size_t size); //'<'
+size_t scan_endtag(const char *f, const size_t pos, const size_t size); //'<' followed by '/' or whitespace
+size_t scan_comment_end(const char *f, const size_t pos, const size_t size); //"-->"
+size_t scan_tagname_end(const char *f, const size_t pos, const size_t size); //'>', '/' or whitespace
+size_t scan_attribname_end(const char *f, const size_t pos, const size_t size); //'=', '>', '/' or whitespace
+size_t scan_nonspace(const char *f, const size_t pos, const size_t size); //anything but whitespace
+
+//counts '<' and '=' in f
+void scan_count_markup(const char *f, const size_t size, size_t *lt, size_t *eq);
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "../ext.h"
 
+#include "alloc.h"
 #include "output.h"
 #include "reliq.h"
 #include "exprs.h"
@@ -155,5 +156,5 @@ void
 reliq_scheme_free(reliq_scheme_t *scheme)
 {
   if (scheme->fields)
-    free(scheme->fields);
+    mem_free(scheme->fields);
 }
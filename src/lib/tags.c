@@ -0,0 +1,125 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "../ext.h"
+
+#include "ctype.h"
+#include "utils.h"
+#include "tags.h"
+
+uint8_t
+tag_find(const char *name, const size_t namel)
+{
+  #define TAG(x,y) if (memcasecmp(name+1,x+1,namel-1) == 0) return y
+
+  if (!namel)
+    return TAG_OTHER;
+
+  const char c = tolower_inline(name[0]);
+  switch (namel) {
+    case 1:
+      if (c == 'p')
+        return TAG_P;
+      break;
+    case 2:
+      switch (c) {
+        case 'b': TAG("br",TAG_BR); break;
+        case 'd': TAG("dd",TAG_DD); TAG("dl",TAG_DL); TAG("dt",TAG_DT); break;
+        case 'h': {
+          const char n = tolower_inline(name[1]);
+          if (n >= '1' && n <= '6')
+            return TAG_H1+(n-'1');
+          if (n == 'r')
+            return TAG_HR;
+          break;
+        }
+        case 'l': TAG("li",TAG_LI); break;
+        case 'o': TAG("ol",TAG_OL); break;
+        case 'r': TAG("rp",TAG_RP); TAG("rt",TAG_RT); break;
+        case 't': TAG("td",TAG_TD); TAG("th",TAG_TH); TAG("tr",TAG_TR); break;
+        case 'u': TAG("ul",TAG_UL); break;
+      }
+      break;
+    case 3:
+      switch (c) {
+        case 'c': TAG("col",TAG_COL); break;
+        case 'd': TAG("div",TAG_DIV); break;
+        case 'i': TAG("img",TAG_IMG); break;
+        case 'n': TAG("nav",TAG_NAV); break;
+        case 'p': TAG("pre",TAG_PRE); break;
+        case 'w': TAG("wbr",TAG_WBR); break;
+      }
+      break;
+    case 4:
+      switch (c) {
+        case 'a': TAG("area",TAG_AREA); break;
+        case 'b': TAG("base",TAG_BASE); break;
+        case 'f': TAG("form",TAG_FORM); break;
+        case 'l': TAG("link",TAG_LINK); break;
+        case 'm': TAG("main",TAG_MAIN); TAG("menu",TAG_MENU); TAG("meta",TAG_META); break;
+      }
+      break;
+    case 5:
+      switch (c) {
+        case 'a': TAG("aside",TAG_ASIDE); break;
+        case 'e': TAG("embed",TAG_EMBED); break;
+        case 'i': TAG("input",TAG_INPUT); break;
+        case 'p': TAG("param",TAG_PARAM); break;
+        case 's': TAG("style",TAG_STYLE); break;
+        case 't':
+          TAG("table",TAG_TABLE); TAG("tbody",TAG_TBODY); TAG("tfoot",TAG_TFOOT);
+          TAG("thead",TAG_THEAD); TAG("track",TAG_TRACK);
+          break;
+      }
+      break;
+    case 6:
+      switch (c) {
+        case 'f': TAG("figure",TAG_FIGURE); TAG("footer",TAG_FOOTER); break;
+        case 'h': TAG("header",TAG_HEADER); TAG("hgroup",TAG_HGROUP); break;
+        case 'k': TAG("keygen",TAG_KEYGEN); break;
+        case 'o': TAG("option",TAG_OPTION); break;
+        case 's': TAG("script",TAG_SCRIPT); TAG("search",TAG_SEARCH); TAG("source",TAG_SOURCE); break;
+      }
+      break;
+    case 7:
+      switch (c) {
+        case 'a': TAG("address",TAG_ADDRESS); TAG("article",TAG_ARTICLE); break;
+        case 'c': TAG("caption",TAG_CAPTION); TAG("command",TAG_COMMAND); break;
+        case 'd': TAG("details",TAG_DETAILS); break;
+        case 's': TAG("section",TAG_SECTION); break;
+      }
+      break;
+    case 8:
+      switch (c) {
+        case 'c': TAG("colgroup",TAG_COLGROUP); break;
+        case 'f': TAG("fieldset",TAG_FIELDSET); break;
+        case 'm': TAG("menuitem",TAG_MENUITEM); break;
+        case 'o': TAG("optgroup",TAG_OPTGROUP); break;
+      }
+      break;
+    case 10:
+      switch (c) {
+        case 'b': TAG("blockquote",TAG_BLOCKQUOTE); break;
+        case 'f': TAG("figcaption",TAG_FIGCAPTION); break;
+      }
+      break;
+  }
+
+  #undef TAG
+  return TAG_OTHER;
+}
@@ -0,0 +1,101 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef RELIQ_TAGS_H
+#define RELIQ_TAGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//identifiers of tags known to html parser, every other tag is TAG_OTHER
+enum {
+  TAG_OTHER = 0,
+  TAG_ADDRESS,
+  TAG_AREA,
+  TAG_ARTICLE,
+  TAG_ASIDE,
+  TAG_BASE,
+  TAG_BLOCKQUOTE,
+  TAG_BR,
+  TAG_CAPTION,
+  TAG_COL,
+  TAG_COLGROUP,
+  TAG_COMMAND,
+  TAG_DD,
+  TAG_DETAILS,
+  TAG_DIV,
+  TAG_DL,
+  TAG_DT,
+  TAG_EMBED,
+  TAG_FIELDSET,
+  TAG_FIGCAPTION,
+  TAG_FIGURE,
+  TAG_FOOTER,
+  TAG_FORM,
+  TAG_H1,
+  TAG_H2,
+  TAG_H3,
+  TAG_H4,
+  TAG_H5,
+  TAG_H6,
+  TAG_HEADER,
+  TAG_HGROUP,
+  TAG_HR,
+  TAG_IMG,
+  TAG_INPUT,
+  TAG_KEYGEN,
+  TAG_LI,
+  TAG_LINK,
+  TAG_MAIN,
+  TAG_MENU,
+  TAG_MENUITEM,
+  TAG_META,
+  TAG_NAV,
+  TAG_OL,
+  TAG_OPTGROUP,
+  TAG_OPTION,
+  TAG_P,
+  TAG_PARAM,
+  TAG_PRE,
+  TAG_RP,
+  TAG_RT,
+  TAG_SCRIPT,
+  TAG_SEARCH,
+  TAG_SECTION,
+  TAG_SOURCE,
+  TAG_STYLE,
+  TAG_TABLE,
+  TAG_TBODY,
+  TAG_TD,
+  TAG_TFOOT,
+  TAG_TH,
+  TAG_THEAD,
+  TAG_TR,
+  TAG_TRACK,
+  TAG_UL,
+  TAG_WBR,
+  TAG_COUNT
+};
+
+/*
+    Returns identifier of tag name, case insensitively. Lookup dispatches on
+    length and first character so at most a few names are compared.
+*/
+uint8_t tag_find(const char *name, const size_t namel);
+
+#endif
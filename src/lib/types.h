@@ -33,6 +33,7 @@ typedef struct {
 
 //#define SCHEME_DEBUG
 //#define EXPR_DEBUG
+//#define NPATTERN_DEBUG
 //#define TOKEN_DEBUG
 //#define NCOLLECTOR_DEBUG
 //#define FCOLLECTOR_DEBUG
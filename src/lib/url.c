@@ -22,6 +22,7 @@
 #include <string.h>
 #include <assert.h>
 
+#include "alloc.h"
 #include "types.h"
 #include "ctype.h"
 #include "utils.h"
@@ -378,8 +379,8 @@ url_realloc(reliq_url *url, const size_t newsize)
   // benchmarks have shown that it's faster to free() and malloc() memory again for small sizes than to use realloc()
   //return realloc(url->url.b,newsize);
   if (url->url.b)
-    free(url->url.b);
-  return malloc(newsize);
+    mem_free(url->url.b);
+  return mem_alloc(newsize);
 }
 
 static void
@@ -439,7 +440,7 @@ url_finalize(reliq_url *url, const bool reuse)
     }
     u = alloca(s);
   } else
-    u = malloc(s);
+    u = mem_alloc(s);
 
   char *t = u;
 
@@ -499,7 +500,7 @@ url_finalize_path(reliq_url *url, const struct urldir *dirs, const size_t dirs_s
     }
     u = alloca(s);
   } else
-    u = malloc(s);
+    u = mem_alloc(s);
 
   char *t = u;
 
@@ -543,7 +544,7 @@ void
 reliq_url_free(reliq_url *url)
 {
   if (url->allocated)
-    free(url->url.b);
+    mem_free(url->url.b);
 }
 
 static inline void
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <regex.h>
 
+#include "alloc.h"
 #include "ctype.h"
 #include "utils.h"
 
@@ -124,7 +125,7 @@ memwordtok_r(const char *ptr, const size_t plen, char const **saveptr, size_t *s
 void *
 memdup(void const *src, const size_t size)
 {
-  return memcpy(malloc(size),src,size);
+  return memcpy(mem_alloc(size),src,size);
 }
 
 int
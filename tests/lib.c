@@ -0,0 +1,406 @@
+/*
+    reliq - html searching tool
+    Copyright (C) 2020-2025 Dominik Stanisław Suchora <hexderm@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Tests of library functions that can't be reached from command line,
+    failed tests are printed the same way as by test.sh. Has to be run
+    from the main directory.
+*/
+
+#include "../src/ext.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#ifdef RELIQ_THREADS
+#include <pthread.h>
+#endif
+
+#include "reliq.h"
+
+#define LENGTH(x) (sizeof(x)/sizeof(*x))
+
+#define HTML_FILE "tests/basic/1.html"
+
+//each of them uses different lookup table of reliq
+const char *scripts[] = {
+  "li | \"%n\\n\"",
+  "* .main; * | \"%n\\n\"",
+  "li; parent@ * | \"%n\\n\"",
+  "li; sibling@ * | \"%n %I\\n\"",
+  "* #cont; child@ * | \"%n\\n\"",
+};
+
+static void
+failed(const char *name, const char *script)
+{
+  printf("%s %s - \033[31mfailed\033[0m\n",name,script);
+}
+
+static char *
+file_read(const char *path, size_t *size)
+{
+  FILE *f = fopen(path,"rb");
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+  fseek(f,0,SEEK_END);
+  *size = ftell(f);
+  rewind(f);
+  char *ret = malloc(*size);
+  if (fread(ret,1,*size,f) != *size) {
+    perror(path);
+    exit(1);
+  }
+  fclose(f);
+  return ret;
+}
+
+//returns output of script, or NULL on error
+static char *
+exec_str(const reliq *rq, const char *script, size_t *len)
+{
+  reliq_expr *expr;
+  reliq_error *err = reliq_ecomp(script,strlen(script),&expr);
+  if (err) {
+    free(err);
+    return NULL;
+  }
+  char *ret;
+  err = reliq_exec_str(rq,NULL,0,expr,&ret,len);
+  reliq_efree(expr);
+  if (err) {
+    free(err);
+    free(ret);
+    return NULL;
+  }
+  return ret;
+}
+
+static bool
+output_eq(const char *s1, const size_t s1l, const char *s2, const size_t s2l)
+{
+  if (!s1 || !s2)
+    return 0;
+  return (s1l == s2l && memcmp(s1,s2,s1l) == 0);
+}
+
+//document is parsed with malloc(3) and executed with arena
+static void
+test_arena_exec(const char *data, const size_t size)
+{
+  reliq rq;
+  reliq_error *err = reliq_init(data,size,&rq);
+  if (err) {
+    free(err);
+    failed("arena_exec","reliq_init");
+    return;
+  }
+  reliq_arena *arena = reliq_arena_new(0);
+  reliq_allocator allocator = reliq_arena_allocator(arena);
+
+  for (size_t i = 0; i < LENGTH(scripts); i++) {
+    size_t expectedl;
+    char *expected = exec_str(&rq,scripts[i],&expectedl);
+
+    //lookup tables are created for the first time while arena is set
+    reliq fresh;
+    if ((err = reliq_init(data,size,&fresh))) {
+      free(err);
+      free(expected);
+      failed("arena_exec",scripts[i]);
+      continue;
+    }
+    reliq_set_allocator(&allocator);
+    size_t outl;
+    char *out = exec_str(&fresh,scripts[i],&outl);
+    bool success = output_eq(expected,expectedl,out,outl);
+    reliq_set_allocator(NULL);
+    reliq_arena_reset(arena);
+
+    //tables have to outlive arena
+    char *again = exec_str(&fresh,scripts[i],&outl);
+    success &= output_eq(expected,expectedl,again,outl);
+    free(again);
+    reliq_free(&fresh);
+    free(expected);
+
+    if (!success)
+      failed("arena_exec",scripts[i]);
+  }
+
+  reliq_arena_free(arena);
+  reliq_free(&rq);
+}
+
+static bool
+file_write(const char *path, const char *data, const size_t size)
+{
+  FILE *f = fopen(path,"wb");
+  if (!f)
+    return 0;
+  bool ret = (fwrite(data,1,size,f) == size);
+  return (fclose(f) == 0 && ret);
+}
+
+//each change has to make reliq_load_mmap() fail
+static void
+load_corrupted(const char *saved, const size_t savedl, const size_t nodes, const size_t attribs, const char *path, const char *name, void (*change)(reliq_chnode*,reliq_cattrib*))
+{
+  char *copy = malloc(savedl);
+  memcpy(copy,saved,savedl);
+  change((reliq_chnode*)(copy+nodes),(reliq_cattrib*)(copy+attribs));
+
+  reliq rq;
+  reliq_error *err = NULL;
+  if (!file_write(path,copy,savedl)) {
+    failed("load_corrupted",name);
+  } else if (!(err = reliq_load_mmap(path,&rq))) {
+    reliq_free(&rq);
+    failed("load_corrupted",name);
+  }
+  free(err);
+  free(copy);
+}
+
+static void
+change_all(reliq_chnode *n, reliq_cattrib UNUSED *a)
+{
+  n[1].all = (reliq_off)-1;
+}
+
+static void
+change_endtag(reliq_chnode *n, reliq_cattrib UNUSED *a)
+{
+  n[1].endtag = n[1].all_len+1;
+}
+
+static void
+change_desc(reliq_chnode *n, reliq_cattrib UNUSED *a)
+{
+  n[0].tag_count = 0xfffffff;
+}
+
+static void
+change_attribs(reliq_chnode *n, reliq_cattrib UNUSED *a)
+{
+  n[1].attribs = (uint32_t)-1;
+}
+
+static void
+change_key(reliq_chnode UNUSED *n, reliq_cattrib *a)
+{
+  a[0].key = (reliq_off)-1;
+}
+
+static void
+test_load_corrupted(const char *data, const size_t size)
+{
+  const char *path = "tests/lib.rq";
+  reliq rq;
+  reliq_error *err = reliq_init(data,size,&rq);
+  if (err || (err = reliq_save(&rq,path))) {
+    free(err);
+    failed("load_corrupted","reliq_save");
+    return;
+  }
+
+  size_t savedl;
+  char *saved = file_read(path,&savedl);
+  //nodes and attribs are stored exactly as in memory
+  const char *nodes = memmem(saved,savedl,rq.nodes,rq.nodesl*sizeof(reliq_chnode));
+  const char *attribs = memmem(saved,savedl,rq.attribs,rq.attribsl*sizeof(reliq_cattrib));
+  if (!nodes || !attribs || rq.nodesl < 2 || !rq.attribsl) {
+    failed("load_corrupted","layout");
+  } else {
+    load_corrupted(saved,savedl,nodes-saved,attribs-saved,path,"all",change_all);
+    load_corrupted(saved,savedl,nodes-saved,attribs-saved,path,"endtag",change_endtag);
+    load_corrupted(saved,savedl,nodes-saved,attribs-saved,path,"tag_count",change_desc);
+    load_corrupted(saved,savedl,nodes-saved,attribs-saved,path,"attribs",change_attribs);
+    load_corrupted(saved,savedl,nodes-saved,attribs-saved,path,"key",change_key);
+  }
+
+  remove(path);
+  free(saved);
+  reliq_free(&rq);
+}
+
+//expressions executed together by reliq_exec_multi()
+const char *multi_scripts[] = {
+  "div has@\"a\" | \"%n\\n\"",
+  "li has@\"a\"; parent@ * | \"%n\\n\"",
+  "{ p, li has@\"a\" }",
+  "{ div has@\"a\" | \"%n\\n\" }, { [0] li | \"%i\\n\" }",
+  "[1:3] li | \"%n %i\\n\"",
+  "ul; [0] li | \"%I\\n\"",
+  "* #cont; child@ * | \"%n\\n\"",
+  "li; { * has@\"a\" }",
+  ".links li has@\"[0] a\"; a | \"%(href)v\\n\"",
+  "div has@\"a\" | \"%n\\n\"",
+  "nothing",
+};
+
+//has to give the same outputs as executing each expression separately
+static void
+test_exec_multi(const char *data, const size_t size)
+{
+  reliq rq;
+  reliq_error *err = reliq_init(data,size,&rq);
+  if (err) {
+    free(err);
+    failed("exec_multi","reliq_init");
+    return;
+  }
+
+  //NULL element has to be skipped
+  const size_t exprsl = LENGTH(multi_scripts)+1;
+  reliq_expr *exprs[LENGTH(multi_scripts)+1] = {NULL};
+  char *strs[LENGTH(multi_scripts)+1];
+  size_t strsl[LENGTH(multi_scripts)+1];
+  for (size_t i = 0; i < LENGTH(multi_scripts); i++) {
+    if ((err = reliq_ecomp(multi_scripts[i],strlen(multi_scripts[i]),&exprs[i+1]))) {
+      free(err);
+      failed("exec_multi",multi_scripts[i]);
+      exprs[i+1] = NULL;
+    }
+  }
+
+  if ((err = reliq_exec_multi(&rq,(const reliq_expr *const*)exprs,exprsl,strs,strsl))) {
+    free(err);
+    failed("exec_multi","reliq_exec_multi");
+  } else {
+    if (strs[0] || strsl[0])
+      failed("exec_multi","NULL");
+    for (size_t i = 0; i < LENGTH(multi_scripts); i++) {
+      size_t expectedl;
+      char *expected = exec_str(&rq,multi_scripts[i],&expectedl);
+      if (!output_eq(expected,expectedl,strs[i+1],strsl[i+1])
+        && (expectedl || strsl[i+1]))
+        failed("exec_multi",multi_scripts[i]);
+      free(expected);
+    }
+  }
+
+  for (size_t i = 0; i < exprsl; i++) {
+    free(strs[i]);
+    if (exprs[i])
+      reliq_efree(exprs[i]);
+  }
+  reliq_free(&rq);
+}
+
+#ifdef RELIQ_THREADS
+
+#define THREADS 8
+#define THREAD_EXECS 20
+
+const char *thread_scripts[] = {
+  "div has@\"a\"",
+  "* has@\"a\" | \"%n %p\\n\"",
+  "li has@\"a\" | \"%n %I\\n\"",
+};
+
+struct thread_exec {
+  const reliq *rq;
+  const char *script;
+  const char *expected;
+  size_t expectedl;
+  bool success;
+};
+
+static void *
+thread_exec(void *arg)
+{
+  struct thread_exec *t = arg;
+  t->success = 1;
+  for (size_t i = 0; i < THREAD_EXECS; i++) {
+    size_t outl;
+    char *out = exec_str(t->rq,t->script,&outl);
+    t->success &= output_eq(t->expected,t->expectedl,out,outl);
+    free(out);
+  }
+  return NULL;
+}
+
+//the same reliq is executed by many threads at once
+static void
+test_threads_exec(const char *data, const size_t size)
+{
+  for (size_t i = 0; i < LENGTH(thread_scripts); i++) {
+    const char *script = thread_scripts[i];
+    size_t expectedl;
+    char *expected;
+    {
+      reliq rq;
+      reliq_error *err = reliq_init(data,size,&rq);
+      if (err) {
+        free(err);
+        failed("threads_exec","reliq_init");
+        return;
+      }
+      expected = exec_str(&rq,script,&expectedl);
+      reliq_free(&rq);
+    }
+
+    reliq rq;
+    reliq_error *err = reliq_init(data,size,&rq);
+    if (err) {
+      free(err);
+      free(expected);
+      failed("threads_exec","reliq_init");
+      return;
+    }
+    struct thread_exec t[THREADS];
+    pthread_t threads[THREADS];
+    for (size_t j = 0; j < THREADS; j++) {
+      t[j] = (struct thread_exec){ .rq = &rq, .script = script, .expected = expected, .expectedl = expectedl };
+      pthread_create(&threads[j],NULL,thread_exec,&t[j]);
+    }
+    bool success = (expected != NULL);
+    for (size_t j = 0; j < THREADS; j++) {
+      pthread_join(threads[j],NULL);
+      success &= t[j].success;
+    }
+    if (!success)
+      failed("threads_exec",script);
+
+    reliq_free(&rq);
+    free(expected);
+  }
+}
+
+#endif //RELIQ_THREADS
+
+int
+main(void)
+{
+  size_t size;
+  char *data = file_read(HTML_FILE,&size);
+
+  test_arena_exec(data,size);
+  test_load_corrupted(data,size);
+  test_exec_multi(data,size);
+  #ifdef RELIQ_THREADS
+  test_threads_exec(data,size);
+  #endif
+
+  free(data);
+  return 0;
+}